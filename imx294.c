@@ -7,13 +7,19 @@
  */
 #include <asm/unaligned.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/gcd.h>
 #include <linux/gpio/consumer.h>
 #include <linux/i2c.h>
+#include <linux/iopoll.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/regmap.h>
 #include <linux/regulator/consumer.h>
+#include <linux/seq_file.h>
 #include <media/v4l2-ctrls.h>
 #include <media/v4l2-device.h>
 #include <media/v4l2-event.h>
@@ -21,12 +27,47 @@
 #include <media/v4l2-mediabus.h>
 #include <linux/moduleparam.h>
 
+#define CREATE_TRACE_POINTS
+#include "imx294_trace.h"
+
 
 
 int debug = 0;
 module_param(debug, int, 0660);
 MODULE_PARM_DESC(debug, "Debug flag");
 
+static bool async_ctrls;
+module_param(async_ctrls, bool, 0444);
+MODULE_PARM_DESC(async_ctrls, "Apply control updates from a worker thread while streaming");
+
+static unsigned int i2c_retries = 2;
+module_param(i2c_retries, uint, 0644);
+MODULE_PARM_DESC(i2c_retries, "Retries of a failed I2C transaction before giving up (max 8)");
+
+static unsigned int i2c_retry_delay_us = 50;
+module_param(i2c_retry_delay_us, uint, 0644);
+MODULE_PARM_DESC(i2c_retry_delay_us, "Delay before the first I2C retry, doubled on each further retry");
+
+static int autosuspend_delay_ms = 1000;
+module_param(autosuspend_delay_ms, int, 0444);
+MODULE_PARM_DESC(autosuspend_delay_ms, "Time the sensor stays powered after streaming stops");
+
+static bool deferred_identify;
+module_param(deferred_identify, bool, 0444);
+MODULE_PARM_DESC(deferred_identify, "Power up and identify the sensor on first use instead of at probe");
+
+static char *default_mode;
+module_param(default_mode, charp, 0444);
+MODULE_PARM_DESC(default_mode, "Readout mode set up at probe: 1, 1A, 1B or 0 (overrides DT)");
+
+static char *default_bayer;
+module_param(default_bayer, charp, 0444);
+MODULE_PARM_DESC(default_bayer, "Bayer order reported at probe: RGGB, GRBG, GBRG or BGGR (overrides DT)");
+
+static unsigned int default_fps;
+module_param(default_fps, uint, 0444);
+MODULE_PARM_DESC(default_fps, "Frame rate set up at probe, 0 keeps the mode default (overrides DT)");
+
 #define DEBUG_PRINTK(fmt, ...) do { if (debug) printk(KERN_DEBUG "%s: " fmt, __this_module.name, ##__VA_ARGS__); } while(0)
 
 
@@ -40,10 +81,28 @@ MODULE_PARM_DESC(debug, "Debug flag");
 
 #define IMX294_XCLK_FREQ		24000000
 
+/* Highest register address, bounds the register cache */
+#define IMX294_REG_MAX			0x3fff
+
 /* VMAX internal VBLANK*/
 #define IMX294_REG_VMAX		0x30A9
 #define IMX294_VMAX_MAX		0xfffff
 
+/* HMAX and VMAX count periods of this clock, a frame lasts HMAX * VMAX */
+#define IMX294_HV_CLK_FREQ		72000000
+
+/* Driver specific controls, not reserved in v4l2-controls.h */
+#define V4L2_CID_IMX294_BASE		(V4L2_CID_USER_BASE + 0x2000)
+#define V4L2_CID_IMX294_FRAMING_POLICY	(V4L2_CID_IMX294_BASE + 0)
+#define V4L2_CID_IMX294_READOUT_TIME	(V4L2_CID_IMX294_BASE + 1)
+
+enum imx294_framing_policy {
+	/* Frame rate through VBLANK on top of the mode's default line time */
+	IMX294_FRAMING_DEFAULT_LINE,
+	/* Shortest line time, all frame period slack in VBLANK */
+	IMX294_FRAMING_MIN_LINE,
+};
+
 /* HMAX internal HBLANK*/
 #define IMX294_REG_HMAX		0x30AC
 #define IMX294_HMAX_MAX		0xffff
@@ -56,6 +115,20 @@ MODULE_PARM_DESC(debug, "Debug flag");
 #define IMX294_REG_PSSLVS4 0x35B8
 #define IMX294_REG_PSSLVS0 0x36BC
 
+/* Readout window */
+#define IMX294_REG_HTRIMMING_START	0x3036
+#define IMX294_REG_HTRIMMING_END	0x3038
+#define IMX294_REG_OPB_SIZE_V		0x312F
+#define IMX294_REG_WRITE_VSIZE		0x3130
+#define IMX294_REG_Y_OUT_SIZE		0x3132
+#define IMX294_WIN_H_ALIGN		16
+#define IMX294_WIN_V_ALIGN		8
+#define IMX294_WIN_MIN_WIDTH		256
+#define IMX294_WIN_MIN_HEIGHT		64
+
+
+/* Register hold, latches grouped writes at the same frame boundary */
+#define IMX294_REG_REGHOLD		0x3001
 
 /* SHR internal */
 #define IMX294_REG_SHR		0x302C
@@ -102,8 +175,36 @@ struct IMX294_reg_list {
 	const struct imx294_reg *regs;
 };
 
+/*
+ * Register tables, packed into burst records at build time from the tables
+ * in imx294_gen_blobs.c
+ */
+#include "imx294_blobs.h"
+
+struct imx294_reg_blob {
+	const char *name;
+	unsigned int len;
+	const u8 *data;
+};
+
+#define IMX294_BLOB(_table) {			\
+	.name = #_table,			\
+	.len = sizeof(_table##_blob),		\
+	.data = _table##_blob,			\
+}
+
+static const struct imx294_reg_blob imx294_common_blob =
+	IMX294_BLOB(mode_common_regs);
+
+/* Standby release after a cold init */
+static const struct imx294_reg_blob imx294_release_blob =
+	IMX294_BLOB(standby_release_regs);
+
 /* Mode : resolution and related config&values */
 struct imx294_mode {
+	/* Readout mode name as used in the datasheet */
+	const char *name;
+
 	/* Frame width */
 	unsigned int width;
 
@@ -134,419 +235,14 @@ struct imx294_mode {
 	struct v4l2_rect crop;
 
 	/* Default register values */
-	struct IMX294_reg_list reg_list;
-};
-
-static const struct imx294_reg mode_common_regs[] = {
-
-    {0x3033,0x30},
-    {0x303C,0x01},
-
-    {0x31E8,0x20}, //PLRD1
-    {0x31E9,0x01},
-
-    {0x3122,0x02}, //PLRD2
-    {0x3129,0x90}, //PLRD3
-    {0x312A,0x02}, //PLRD4
-
-    {0x311F,0x00}, //PLRD10
-    {0x3123,0x00}, //PLRD11
-    {0x3124,0x00}, //PLRD12
-    {0x3125,0x01}, //PLRD13
-    {0x3127,0x02}, //PLRD14
-    {0x312D,0x02}, //PLRD15
-
-    {0x3000,0x12}, //STANDBY = 0 STBLOGIC register = 1h, STBMIPI register = 0h, STBDV register = 1h
-    {0x310B,0x00}, //PLL release
-
-    {0x3047,0x01}, //PLSTMG11
-    {0x304E,0x0B}, //PLSTMG12
-    {0x304F,0x24}, //PLSTMG13
-    {0x3062,0x25}, //PLSTMG14
-    {0x3064,0x78}, //PLSTMG15
-    {0x3065,0x33}, //PLSTMG16
-    {0x3067,0x71}, //PLSTMG17
-    {0x3088,0x75}, //PLSTMG18
-    {0x308A,0x09}, //PLSTMG19
-    {0x308B,0x01}, //PLSTMG19
-    {0x308C,0x61}, //PLSTMG20
-    {0x3146,0x00}, //PLSTMG10
-    {0x3234,0x32}, //PLSTMG21
-    {0x3235,0x00}, //PLSTMG21
-    {0x3248,0xBC}, //PLSTMG22
-    {0x3249,0x00}, //PLSTMG22
-    {0x3250,0xBC}, //PLSTMG23
-    {0x3251,0x00}, //PLSTMG23
-    {0x3258,0xBC}, //PLSTMG24
-    {0x3259,0x00}, //PLSTMG24
-    {0x3260,0xBC}, //PLSTMG25
-    {0x3261,0x00}, //PLSTMG25
-    {0x3274,0x13}, //PLSTMG26
-    {0x3275,0x00}, //PLSTMG26
-    {0x3276,0x1F}, //PLSTMG27
-    {0x3277,0x00}, //PLSTMG27
-    {0x3278,0x30}, //PLSTMG28
-    {0x3279,0x00}, //PLSTMG28
-    {0x327C,0x13}, //PLSTMG29
-    {0x327D,0x00}, //PLSTMG29
-    {0x327E,0x1F}, //PLSTMG30
-    {0x327F,0x00}, //PLSTMG30
-    {0x3280,0x30}, //PLSTMG31
-    {0x3281,0x00}, //PLSTMG31
-    {0x3284,0x13}, //PLSTMG32
-    {0x3285,0x00}, //PLSTMG32
-    {0x3286,0x1F}, //PLSTMG33
-    {0x3287,0x00}, //PLSTMG33
-    {0x3288,0x30}, //PLSTMG34
-    {0x3289,0x00}, //PLSTMG34
-    {0x328C,0x13}, //PLSTMG35
-    {0x328D,0x00}, //PLSTMG35
-    {0x328E,0x1F}, //PLSTMG36
-    {0x328F,0x00}, //PLSTMG36
-    {0x3290,0x30}, //PLSTMG37
-    {0x3291,0x00}, //PLSTMG37
-    {0x32AE,0x00}, //PLSTMG38
-    {0x32AF,0x00}, //PLSTMG39
-    {0x32CA,0x5A}, //PLSTMG40
-    {0x32CB,0x00}, //PLSTMG40
-    {0x332F,0x00}, //PLSTMG41
-    {0x334C,0x01}, //PLSTMG09
-    {0x335A,0x79}, //PLSTMG43
-    {0x335B,0x00}, //PLSTMG43
-    {0x335E,0x56}, //PLSTMG44
-    {0x335F,0x00}, //PLSTMG44
-    {0x3360,0x6A}, //PLSTMG45
-    {0x3361,0x00}, //PLSTMG45
-    {0x336A,0x56}, //PLSTMG46
-    {0x336B,0x00}, //PLSTMG46
-    {0x33D6,0x79}, //PLSTMG47
-    {0x33D7,0x00}, //PLSTMG47
-    {0x340C,0x6E}, //PLSTMG48
-    {0x340D,0x00}, //PLSTMG48
-    {0x3448,0x7E}, //PLSTMG49
-    {0x3449,0x00}, //PLSTMG49
-    {0x348E,0x6F}, //PLSTMG50
-    {0x348F,0x00}, //PLSTMG50
-    {0x3492,0x11}, //PLSTMG51
-    {0x34C4,0x5A}, //PLSTMG52
-    {0x34C5,0x00}, //PLSTMG52
-    {0x3506,0x56}, //PLSTMG53
-    {0x3507,0x00}, //PLSTMG53
-    {0x350C,0x56}, //PLSTMG54
-    {0x350D,0x00}, //PLSTMG54
-    {0x350E,0x58}, //PLSTMG55
-    {0x350F,0x00}, //PLSTMG55
-    {0x3549,0x04}, //PLSTMG56
-    {0x355D,0x03}, //PLSTMG57
-    {0x355E,0x03}, //PLSTMG58
-    {0x3574,0x56}, //PLSTMG59
-    {0x3575,0x00}, //PLSTMG59
-    {0x3587,0x01}, //PLSTMG60
-    {0x35D0,0x5E}, //PLSTMG61
-    {0x35D1,0x00}, //PLSTMG61
-    {0x35D4,0x63}, //PLSTMG62
-    {0x35D5,0x00}, //PLSTMG62
-    {0x366A,0x1A}, //PLSTMG63
-    {0x366B,0x16}, //PLSTMG64
-    {0x366C,0x10}, //PLSTMG65
-    {0x366D,0x09}, //PLSTMG66
-    {0x366E,0x00}, //PLSTMG67
-    {0x366F,0x00}, //PLSTMG68
-    {0x3670,0x00}, //PLSTMG69
-    {0x3671,0x00}, //PLSTMG70
-    {0x3676,0x83}, //PLSTMG73
-    {0x3677,0x03}, //PLSTMG73
-    {0x3678,0x00}, //PLSTMG74
-    {0x3679,0x04}, //PLSTMG74
-    {0x367A,0x2C}, //PLSTMG75
-    {0x367B,0x05}, //PLSTMG75
-    {0x367C,0x00}, //PLSTMG76
-    {0x367D,0x06}, //PLSTMG76
-    {0x367E,0x00}, //PLSTMG77
-    {0x367F,0x07}, //PLSTMG77
-    {0x3680,0x4B}, //PLSTMG78
-    {0x3681,0x07}, //PLSTMG78
-    {0x3690,0x27}, //PLSTMG79
-    {0x3691,0x00}, //PLSTMG79
-    {0x3692,0x65}, //PLSTMG80
-    {0x3693,0x00}, //PLSTMG80
-    {0x3694,0x4F}, //PLSTMG81
-    {0x3695,0x00}, //PLSTMG81
-    {0x3696,0xA1}, //PLSTMG82
-    {0x3697,0x00}, //PLSTMG82
-    {0x382B,0x68}, //PLSTMG83
-    {0x3C00,0x01}, //PLSTMG84
-    {0x3C01,0x01}, //PLSTMG85
-    {0x3686,0x00}, //PLSTMG101
-    {0x3687,0x00}, //PLSTMG101
-    {0x36BE,0x01}, //PLSTMG102
-    {0x36BF,0x00}, //PLSTMG102
-    {0x36C0,0x01}, //PLSTMG103
-    {0x36C1,0x00}, //PLSTMG103
-    {0x36C2,0x01}, //PLSTMG104
-    {0x36C3,0x00}, //PLSTMG104
-    {0x36C4,0x01}, //PLSTMG105
-    {0x36C5,0x01}, //PLSTMG106
-    {0x36C6,0x01}, //PLSTMG107
-
-
-    {0x3134,0xAF}, //tclkpost
-    {0x3135,0x00},
-    {0x3136,0xC7}, //thszero
-    {0x3137,0x00},
-    {0x3138,0x7F}, //thsprepare
-    {0x3139,0x00},
-    {0x313A,0x6F}, //tclktrail
-    {0x313B,0x00},
-    {0x313C,0x6F}, //thstrail
-    {0x313D,0x00},
-    {0x313E,0xCF}, //tclkzero
-    {0x313F,0x01},
-    {0x3140,0x77}, //tclkprepare
-    {0x3141,0x00},
-    {0x3142,0x5F}, //tlpx
-    {0x3143,0x00},
-
-    {0x3004,0x1A}, //MDSEL1 
-    {0x3005,0x06}, //MDSEL2 
-    {0x3006,0x00}, //MDSEL3 
-    {0x3007,0xA0}, //MDSEL4 
-    {0x3019,0x00}, //MDVREV 
-    {0x3030,0x77}, //MDSEL5 
-    {0x3034,0x00}, //HOPBOUT_EN 
-    {0x3035,0x01}, //HTRIMMING_EN 
-    {0x3036,0x30}, //HTRIMMING_START 
-    {0x3037,0x00}, //HTRIMMING_START 
-    {0x3038,0x60}, //HTRIMMING_END 
-    {0x3039,0x10}, //HTRIMMING_END 
-    {0x3068,0x1A}, //MDSEL15 
-    {0x3069,0x00}, //MDSEL15 
-    {0x3080,0x00}, //MDSEL6 
-    {0x3081,0x01}, //MDSEL7 
-    {0x30A8,0x02}, //MDSEL8 
-    {0x30E2,0x00}, //VCUTMODE 
-    {0x312F,0x08}, //OPB_SIZE_V 
-    {0x3130,0x88}, //WRITE_VSIZE 
-    {0x3131,0x08}, //WRITE_VSIZE 
-    {0x3132,0x80}, //OUT_SIZE 
-    {0x3133,0x08}, //Y_OUT_SIZE 
-    {0x357F,0x0C}, //MDSEL11 
-    {0x3580,0x0A}, //MDSEL12 
-    {0x3581,0x08}, //MDSEL13 
-    {0x3583,0x72}, //MDSEL14 
-    {0x3600,0x90}, //MDSEL16 
-    {0x3601,0x00}, //MDSEL16 
-    {0x3846,0x00}, //MDSEL9 
-    {0x3847,0x00}, //MDSEL9 
-    {0x384A,0x00}, //MDSEL10 
-    {0x384B,0x00}, //MDSEL10
-
-
-
-    //SVR = 0
-    {0x300E,0x00},
-    {0x300F,0x00},
-
-    //SHR = 100
-    {0x302C,0x10},
-    {0x302D,0x00},
-
-    //VMAX = 5000
-    {0x30A9,0x88},
-    {0x30AA,0x13},
-    {0x30AB,0x00},
-
-    //HMAX = 1200
-    {0x30AC,0xB0},
-    {0x30AD,0x04},
-    //HCOUNT1 Set the same value as HMAX 
-    {0x3084,0xB0},
-    {0x3085,0x04},
-    //HCOUNT2 Set the same value as HMAX 
-    {0x3086,0xB0},
-    {0x3087,0x04},
-
-    {0x332C,0x00}, //PSSLVS1 = VBLK = VMAX × (SVR value + 1) - minimum VMAX setting = VMAX - minimum VMAX
-    {0x332D,0x00}, //
-    {0x334A,0x00}, //PSSLVS2 = VBLK 
-    {0x334B,0x00}, //
-    {0x35B6,0x00}, //PSSLVS3 = VBLK
-    {0x35B7,0x00}, //
-    {0x35B8,0x00}, //PSSLVS4 = VBLK - 5 
-    {0x35B9,0x00}, //
-    {0x36BC,0x00}, //PSSLVS0 = VBLK
-    {0x36BD,0x00}, //
-
-    //delay 10ms
-    {0xFFFE,0x0A},
-
-    {0x3000,0x02}, //(STANDBY register = 0h, STBLOGIC register = 1h, STBMIPI register = 0h, STBDV register = 0h
-    {0x35E5,0x92},
-    {0x35E5,0x9A},
-    {0x3000,0x00}, //(STANDBY register = 0h, STBLOGIC register = 0h, STBMIPI register = 0h, STBDV register = 0h
-
-    
-    //delay 10ms
-    {0xFFFE,0x0A},
-
-    {0x3033,0x20},
-    {0x3017,0xA8},
-};
-
-
-/* 3704 x 2778 readout mode 0 - 12bit */
-static const struct imx294_reg mode_00_regs[] = {
-    {0x3004,0x00}, //MDSEL1 
-    {0x3005,0x06}, //MDSEL2 
-    {0x3006,0x02}, //MDSEL3 
-    {0x3007,0xA0}, //MDSEL4 
-    {0x3019,0x00}, //MDVREV 
-    {0x3030,0x77}, //MDSEL5 
-    {0x3034,0x00}, //HOPBOUT_EN 
-    {0x3035,0x01}, //HTRIMMING_EN 
-    {0x3036,0x30}, //HTRIMMING_START 
-    {0x3037,0x00}, //HTRIMMING_START 
-    {0x3038,0x00}, //HTRIMMING_END 
-    {0x3039,0x0F}, //HTRIMMING_END 
-    {0x3068,0x1A}, //MDSEL15 
-    {0x3069,0x00}, //MDSEL15 
-    {0x3080,0x00}, //MDSEL6 
-    {0x3081,0x01}, //MDSEL7 
-    {0x30A8,0x02}, //MDSEL8 
-    {0x30E2,0x00}, //VCUTMODE 
-    {0x312F,0x10}, //OPB_SIZE_V 
-    {0x3130,0x18}, //WRITE_VSIZE 
-    {0x3131,0x0B}, //WRITE_VSIZE 
-    {0x3132,0x08}, //OUT_SIZE 
-    {0x3133,0x0B}, //Y_OUT_SIZE 
-    {0x357F,0x0C}, //MDSEL11 
-    {0x3580,0x0A}, //MDSEL12 
-    {0x3581,0x08}, //MDSEL13 
-    {0x3583,0x72}, //MDSEL14 
-    {0x3600,0x90}, //MDSEL16 
-    {0x3601,0x00}, //MDSEL16 
-    {0x3846,0x00}, //MDSEL9 
-    {0x3847,0x00}, //MDSEL9 
-    {0x384A,0x00}, //MDSEL10 
-    {0x384B,0x00}, //MDSEL10
-};
-
-
-/* 4096 x 2160 readout mode 1 */
-static const struct imx294_reg mode_01_regs[] = {
-    {0x3004,0x1A}, //MDSEL1 
-    {0x3005,0x06}, //MDSEL2 
-    {0x3006,0x00}, //MDSEL3 
-    {0x3007,0xA0}, //MDSEL4 
-    {0x3019,0x00}, //MDVREV 
-    {0x3030,0x77}, //MDSEL5 
-    {0x3034,0x00}, //HOPBOUT_EN 
-    {0x3035,0x01}, //HTRIMMING_EN 
-    {0x3036,0x30}, //HTRIMMING_START 
-    {0x3037,0x00}, //HTRIMMING_START 
-    {0x3038,0x60}, //HTRIMMING_END 
-    {0x3039,0x10}, //HTRIMMING_END 
-    {0x3068,0x1A}, //MDSEL15 
-    {0x3069,0x00}, //MDSEL15 
-    {0x3080,0x00}, //MDSEL6 
-    {0x3081,0x01}, //MDSEL7 
-    {0x30A8,0x02}, //MDSEL8 
-    {0x30E2,0x00}, //VCUTMODE 
-    {0x312F,0x08}, //OPB_SIZE_V 
-    {0x3130,0x88}, //WRITE_VSIZE 
-    {0x3131,0x08}, //WRITE_VSIZE 
-    {0x3132,0x80}, //OUT_SIZE 
-    {0x3133,0x08}, //Y_OUT_SIZE 
-    {0x357F,0x0C}, //MDSEL11 
-    {0x3580,0x0A}, //MDSEL12 
-    {0x3581,0x08}, //MDSEL13 
-    {0x3583,0x72}, //MDSEL14 
-    {0x3600,0x90}, //MDSEL16 
-    {0x3601,0x00}, //MDSEL16 
-    {0x3846,0x00}, //MDSEL9 
-    {0x3847,0x00}, //MDSEL9 
-    {0x384A,0x00}, //MDSEL10 
-    {0x384B,0x00}, //MDSEL10
-};
-
-/* 4096 x 2160 low noise readout mode 1A */
-static const struct imx294_reg mode_01A_regs[] = {
-    {0x3004,0x01}, //MDSEL1 
-    {0x3005,0x06}, //MDSEL2 
-    {0x3006,0x00}, //MDSEL3 
-    {0x3007,0xA0}, //MDSEL4 
-    {0x3019,0x00}, //MDVREV 
-    {0x3030,0x77}, //MDSEL5 
-    {0x3034,0x00}, //HOPBOUT_EN 
-    {0x3035,0x01}, //HTRIMMING_EN 
-    {0x3036,0x30}, //HTRIMMING_START 
-    {0x3037,0x00}, //HTRIMMING_START 
-    {0x3038,0x80}, //HTRIMMING_END 
-    {0x3039,0x10}, //HTRIMMING_END 
-    {0x3068,0x1A}, //MDSEL15 
-    {0x3069,0x00}, //MDSEL15 
-    {0x3080,0x01}, //MDSEL6 
-    {0x3081,0x01}, //MDSEL7 
-    {0x30A8,0x02}, //MDSEL8 
-    {0x30E2,0x00}, //VCUTMODE 
-    {0x312F,0x08}, //OPB_SIZE_V 
-    {0x3130,0x88}, //WRITE_VSIZE 
-    {0x3131,0x08}, //WRITE_VSIZE 
-    {0x3132,0x80}, //OUT_SIZE 
-    {0x3133,0x08}, //Y_OUT_SIZE 
-    {0x357F,0x0C}, //MDSEL11 
-    {0x3580,0x0A}, //MDSEL12 
-    {0x3581,0x08}, //MDSEL13 
-    {0x3583,0x72}, //MDSEL14 
-    {0x3600,0x7D}, //MDSEL16 
-    {0x3601,0x00}, //MDSEL16 
-    {0x3846,0x00}, //MDSEL9 
-    {0x3847,0x00}, //MDSEL9 
-    {0x384A,0x00}, //MDSEL10 
-    {0x384B,0x00}, //MDSEL10
-};
-
-/* 3840 x 2160 readout mode 1B */
-static const struct imx294_reg mode_01B_regs[] = {
-    {0x3004,0x02}, //MDSEL1 
-    {0x3005,0x06}, //MDSEL2 
-    {0x3006,0x01}, //MDSEL3 
-    {0x3007,0xA0}, //MDSEL4 
-    {0x3019,0x00}, //MDVREV 
-    {0x3030,0x77}, //MDSEL5 
-    {0x3034,0x00}, //HOPBOUT_EN 
-    {0x3035,0x01}, //HTRIMMING_EN 
-    {0x3036,0x30}, //HTRIMMING_START 
-    {0x3037,0x00}, //HTRIMMING_START 
-    {0x3038,0x50}, //HTRIMMING_END 
-    {0x3039,0x0F}, //HTRIMMING_END 
-    {0x3068,0x1A}, //MDSEL15 
-    {0x3069,0x00}, //MDSEL15 
-    {0x3080,0x00}, //MDSEL6 
-    {0x3081,0x01}, //MDSEL7 
-    {0x30A8,0x02}, //MDSEL8 
-    {0x30E2,0x00}, //VCUTMODE 
-    {0x312F,0x08}, //OPB_SIZE_V 
-    {0x3130,0x88}, //WRITE_VSIZE 
-    {0x3131,0x08}, //WRITE_VSIZE 
-    {0x3132,0x80}, //OUT_SIZE 
-    {0x3133,0x08}, //Y_OUT_SIZE 
-    {0x357F,0x0C}, //MDSEL11 
-    {0x3580,0x0A}, //MDSEL12 
-    {0x3581,0x08}, //MDSEL13 
-    {0x3583,0x72}, //MDSEL14 
-    {0x3600,0x90}, //MDSEL16 
-    {0x3601,0x00}, //MDSEL16 
-    {0x3846,0x00}, //MDSEL9 
-    {0x3847,0x00}, //MDSEL9 
-    {0x384A,0x00}, //MDSEL10 
-    {0x384B,0x00}, //MDSEL10
+	struct imx294_reg_blob blob;
 };
 
 /* Mode configs */
 static const struct imx294_mode supported_modes_12bit[] = {
 	{
 		/* 4096 x 2160 readout mode 1 */
+		.name = "1",
 		.width = 4144,
 		.height = 2184,
 		.min_HMAX = 1122,
@@ -562,13 +258,11 @@ static const struct imx294_mode supported_modes_12bit[] = {
 			.width = 4096,
 			.height = 2160,
 		},
-		.reg_list = {
-			.num_of_regs = ARRAY_SIZE(mode_01_regs),
-			.regs = mode_01_regs,
-		},
+		.blob = IMX294_BLOB(mode_01_regs),
 	},
     {
         /* 4096 x 2160 low noise readout mode 1A */
+        .name = "1A",
         .width = 4176,
         .height = 2184,
         .min_HMAX = 1192,
@@ -584,13 +278,11 @@ static const struct imx294_mode supported_modes_12bit[] = {
             .width = 4096,
             .height = 2160,
         },
-        .reg_list = {
-            .num_of_regs = ARRAY_SIZE(mode_01A_regs),
-            .regs = mode_01A_regs,
-        },
+        .blob = IMX294_BLOB(mode_01A_regs),
     },
     {
         /* 3840 x 2160 low noise readout mode 1B */
+        .name = "1B",
         .width = 3872,
         .height = 2180,
         .min_HMAX = 1055,
@@ -606,13 +298,11 @@ static const struct imx294_mode supported_modes_12bit[] = {
             .width = 3840,
             .height = 2160,
         },
-        .reg_list = {
-            .num_of_regs = ARRAY_SIZE(mode_01B_regs),
-            .regs = mode_01B_regs,
-        },
+        .blob = IMX294_BLOB(mode_01B_regs),
     },
     {
         /* 3740 x 2778 readout mode 0 */
+        .name = "0",
         .width = 3792,
         .height = 2840,
         .min_HMAX = 1024,
@@ -628,10 +318,7 @@ static const struct imx294_mode supported_modes_12bit[] = {
             .width = 3704,
             .height = 2778,
         },
-        .reg_list = {
-            .num_of_regs = ARRAY_SIZE(mode_00_regs),
-            .regs = mode_00_regs,
-        },
+        .blob = IMX294_BLOB(mode_00_regs),
     },
 };
 
@@ -644,6 +331,8 @@ static const struct imx294_mode supported_modes_12bit[] = {
  * - h flip
  * - v flip
  * - h&v flips
+ * Only 12-bit output is supported, the register settings for the 10-bit
+ * AD/output configuration are not available.
  */
 static const u32 codes[] = {
 	/* 12-bit modes. */
@@ -654,6 +343,11 @@ static const u32 codes[] = {
 
 };
 
+/* Bayer order names accepted for the default format, in codes[] order */
+static const char * const imx294_bayer_names[] = {
+	"RGGB", "GRBG", "GBRG", "BGGR",
+};
+
 /* regulator supplies */
 static const char * const imx294_supply_name[] = {
 	/* Supplies can be enabled in any order */
@@ -670,10 +364,78 @@ static const char * const imx294_supply_name[] = {
  * datasheet is 8ms.  This does include I2C setup time as well.
  *
  * Note, that delay between XCLR low->high and reading the CCI ID register (T6
- * in the datasheet) is much smaller - 600us.
+ * in the datasheet) is much smaller - 600us. Power-on only waits T6 and then
+ * polls the CCI until it answers; the rest of T7 is waited out right before
+ * the first standby release. Boards with slow supply ramps can extend both
+ * with the "sony,power-on-margin-us" property.
  */
-#define imx294_XCLR_MIN_DELAY_US	100000
-#define imx294_XCLR_DELAY_RANGE_US	1000
+#define IMX294_XCLR_CCI_DELAY_US	600
+#define IMX294_XCLR_STANDBY_DELAY_US	8000
+#define IMX294_CCI_POLL_US		100
+#define IMX294_CCI_TIMEOUT_US		20000
+
+/* Upper bounds of the I2C retry backoff */
+#define IMX294_I2C_MAX_RETRIES		8U
+#define IMX294_I2C_MAX_RETRY_DELAY_US	USEC_PER_SEC
+
+/* Upper bounds of a batch of control register writes */
+#define IMX294_BATCH_MAX_MSGS		16
+#define IMX294_BATCH_BUF_LEN		96
+
+/*
+ * Register writes collected for a single multi-message transfer. msgs[0] and
+ * the slot after the last queued write are reserved for the REGHOLD bracket.
+ */
+struct imx294_batch {
+	struct i2c_msg msgs[IMX294_BATCH_MAX_MSGS + 2];
+	u8 buf[IMX294_BATCH_BUF_LEN];
+	u8 hold_on[3];
+	u8 hold_off[3];
+	unsigned int num_msgs;
+	unsigned int len;
+	int err;
+};
+
+/*
+ * Last values written to the per-frame timing registers, so control updates
+ * that would not change anything skip the bus altogether.
+ */
+#define IMX294_SHADOW_INVALID		U32_MAX
+
+struct imx294_shadow {
+	u32 shr;
+	u32 gain;
+	u32 vmax;
+	u32 vblk;	/* PSSLVS0..4, VMAX less the mode/window minimum */
+	u32 hmax;	/* Also written to HCOUNT1/2 */
+};
+
+/* Bus transaction classes tracked in debugfs */
+enum imx294_xfer_type {
+	IMX294_XFER_READ,
+	IMX294_XFER_WRITE1,
+	IMX294_XFER_WRITE2,
+	IMX294_XFER_WRITE3,
+	IMX294_XFER_BURST,
+	IMX294_XFER_BATCH,
+	IMX294_NUM_XFER_TYPES
+};
+
+static const char * const imx294_xfer_names[] = {
+	"read", "write1", "write2", "write3", "burst", "batch",
+};
+
+/* Latency histogram buckets, bucket n counts [2^(n-1), 2^n) us */
+#define IMX294_LAT_BUCKETS		12
+
+struct imx294_xfer_stats {
+	u64 transactions;
+	u64 bytes;
+	u64 naks;
+	u64 errors;
+	u64 retries;
+	u32 latency[IMX294_LAT_BUCKETS];
+};
 
 struct imx294_compatible_data {
 	unsigned int chip_id;
@@ -692,20 +454,60 @@ struct imx294 {
 	struct gpio_desc *reset_gpio;
 	struct regulator_bulk_data supplies[imx294_NUM_SUPPLIES];
 
+	/* Last sequencing anchor reached in a register table */
+	ktime_t settle_anchor;
+
+	/* Extra power-up settle time required by the board */
+	u32 power_on_margin_us;
+	/* When XCLR was last released, for the T7 standby-exit wait */
+	ktime_t xclr_time;
+
+	struct regmap *regmap;
+
 	struct v4l2_ctrl_handler ctrl_handler;
 	/* V4L2 Controls */
 	struct v4l2_ctrl *pixel_rate;
-	struct v4l2_ctrl *exposure;
+	struct {
+		/* Exposure/gain cluster, exposure is the master */
+		struct v4l2_ctrl *exposure;
+		struct v4l2_ctrl *gain;
+	};
 	struct v4l2_ctrl *vflip;
 	struct v4l2_ctrl *hflip;
 	struct v4l2_ctrl *vblank;
 	struct v4l2_ctrl *hblank;
+	struct v4l2_ctrl *framing_policy;
+	struct v4l2_ctrl *readout_time;
+
+	/* Framing policy in effect, see enum imx294_framing_policy */
+	u32 policy;
 
 	/* Current mode */
 	const struct imx294_mode *mode;
 
 	uint16_t HMAX;
 	uint32_t VMAX;
+
+	/* Timing register values currently held by the sensor */
+	struct imx294_shadow shadow;
+
+	/* Control writes being collected, and the shadow once they land */
+	struct imx294_batch batch;
+	struct imx294_shadow pending;
+	unsigned int ctrl_depth;
+
+	/* Bus statistics and table write verification, see debugfs */
+	struct imx294_xfer_stats stats[IMX294_NUM_XFER_TYPES];
+	u64 settle_waits;
+	u64 settle_us;
+	bool verify;
+	u32 verify_errors;
+	struct dentry *debugfs;
+
+	/* Optional worker applying control updates asynchronously */
+	struct kthread_worker *ctrl_worker;
+	struct kthread_work ctrl_work;
+	bool ctrl_dirty;
 	/*
 	 * Mutex for serialized access:
 	 * Protect sensor module set pad format and start/stop streaming safely.
@@ -718,15 +520,71 @@ struct imx294 {
 	/* Rewrite common registers on stream on? */
 	bool common_regs_written;
 
+	/* Chip ID has been read back since probe */
+	bool identified;
+
+	/*
+	 * Readout window within the current mode's output frame, and the
+	 * matching crop rectangle reported to userspace
+	 */
+	struct v4l2_rect win;
+	struct v4l2_rect crop;
+
+	/* Format and frame rate the sensor starts out with */
+	const struct imx294_mode *init_mode;
+	u32 init_code;
+	u32 init_fps;
+
+	/* Mode whose register table was last written to the sensor */
+	const struct imx294_mode *programmed_mode;
+
 	/* Any extra information related to different compatible sensors */
 	const struct imx294_compatible_data *compatible_data;
 };
 
+/*
+ * Registers that must always reach the bus: MODE_SELECT doubles as the
+ * status/chip ID register, 0x35E5 is written twice as a trigger during the
+ * standby release sequence. The rest change value along the power-up
+ * sequence, so the cache never holds a value a differential write could
+ * wrongly skip.
+ */
+static const struct regmap_range imx294_volatile_ranges[] = {
+	regmap_reg_range(IMX294_REG_MODE_SELECT, IMX294_REG_MODE_SELECT),
+	regmap_reg_range(0x3017, 0x3017),
+	regmap_reg_range(0x3033, 0x3033),
+	regmap_reg_range(0x310B, 0x310B),
+	regmap_reg_range(0x35E5, 0x35E5),
+};
+
+static const struct regmap_access_table imx294_volatile_table = {
+	.yes_ranges = imx294_volatile_ranges,
+	.n_yes_ranges = ARRAY_SIZE(imx294_volatile_ranges),
+};
+
+static const struct regmap_config imx294_regmap_config = {
+	.reg_bits = 16,
+	.val_bits = 8,
+	.max_register = IMX294_REG_MAX,
+	.volatile_table = &imx294_volatile_table,
+	.cache_type = REGCACHE_RBTREE,
+};
+
 static inline struct imx294 *to_imx294(struct v4l2_subdev *_sd)
 {
 	return container_of(_sd, struct imx294, sd);
 }
 
+/* Forget the timing register shadow, the next control writes all go out */
+static void imx294_shadow_invalidate(struct imx294 *imx294)
+{
+	imx294->shadow.shr = IMX294_SHADOW_INVALID;
+	imx294->shadow.gain = IMX294_SHADOW_INVALID;
+	imx294->shadow.vmax = IMX294_SHADOW_INVALID;
+	imx294->shadow.vblk = IMX294_SHADOW_INVALID;
+	imx294->shadow.hmax = IMX294_SHADOW_INVALID;
+}
+
 static inline void get_mode_table(unsigned int code,
 				  const struct imx294_mode **mode_list,
 				  unsigned int *num_modes)
@@ -746,109 +604,421 @@ static inline void get_mode_table(unsigned int code,
 	}
 }
 
-/* Read registers up to 2 at a time */
+/* Record one bus transaction in the debugfs statistics */
+static void imx294_account(struct imx294 *imx294, enum imx294_xfer_type type,
+			   u32 bytes, ktime_t start, int ret)
+{
+	struct imx294_xfer_stats *stats = &imx294->stats[type];
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	stats->transactions++;
+	stats->latency[min_t(unsigned int, us > 0 ? fls64(us) : 0,
+			     IMX294_LAT_BUCKETS - 1)]++;
+
+	if (!ret) {
+		stats->bytes += bytes;
+		return;
+	}
+
+	stats->errors++;
+	/* What a NAK maps to depends on the adapter driver */
+	if (ret == -ENXIO || ret == -EREMOTEIO)
+		stats->naks++;
+}
+
+/*
+ * Decide whether to retry a failed transaction, backing off before doing so.
+ * Glitches on the bus are usually transient, and a retry is far cheaper than
+ * tearing the stream down and power cycling the sensor.
+ */
+static bool imx294_retry(struct imx294 *imx294, enum imx294_xfer_type type,
+			 unsigned int attempt)
+{
+	u64 delay_us;
+
+	/* Both parameters are writable at any time, bound the backoff */
+	if (attempt >= min(i2c_retries, IMX294_I2C_MAX_RETRIES))
+		return false;
+
+	delay_us = (u64)i2c_retry_delay_us << attempt;
+	imx294->stats[type].retries++;
+	fsleep(min_t(u64, delay_us, IMX294_I2C_MAX_RETRY_DELAY_US));
+
+	return true;
+}
+
+/* Read registers up to 4 at a time */
 static int imx294_read_reg(struct imx294 *imx294, u16 reg, u32 len, u32 *val)
 {
-	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	struct i2c_msg msgs[2];
-	u8 addr_buf[2] = { reg >> 8, reg & 0xff };
 	u8 data_buf[4] = { 0, };
+	unsigned int attempt;
+	ktime_t start;
 	int ret;
 
 	if (len > 4)
 		return -EINVAL;
 
-	/* Write register address */
-	msgs[0].addr = client->addr;
-	msgs[0].flags = 0;
-	msgs[0].len = ARRAY_SIZE(addr_buf);
-	msgs[0].buf = addr_buf;
-
-	/* Read data from register */
-	msgs[1].addr = client->addr;
-	msgs[1].flags = I2C_M_RD;
-	msgs[1].len = len;
-	msgs[1].buf = &data_buf[4 - len];
-
-	ret = i2c_transfer(client->adapter, msgs, ARRAY_SIZE(msgs));
-	if (ret != ARRAY_SIZE(msgs))
-		return -EIO;
+	for (attempt = 0; ; attempt++) {
+		start = ktime_get();
+		ret = regmap_bulk_read(imx294->regmap, reg, &data_buf[4 - len],
+				       len);
+		imx294_account(imx294, IMX294_XFER_READ, len, start, ret);
+		if (!ret || !imx294_retry(imx294, IMX294_XFER_READ, attempt))
+			break;
+	}
+	if (ret)
+		return ret;
 
 	*val = get_unaligned_be32(data_buf);
 
 	return 0;
 }
 
+/*
+ * Check whether the register cache already holds @vals from @reg onwards.
+ * Lookups are done cache-only so a miss never turns into a bus read.
+ */
+static bool imx294_regs_cached(struct imx294 *imx294, u16 reg,
+			       const u8 *vals, u32 len)
+{
+	unsigned int i, cur;
+	bool cached = true;
+
+	regcache_cache_only(imx294->regmap, true);
+	for (i = 0; i < len && cached; i++)
+		cached = !regmap_read(imx294->regmap, reg + i, &cur) &&
+			 cur == vals[i];
+	regcache_cache_only(imx294->regmap, false);
+
+	return cached;
+}
+
+/* Write a run of consecutive registers using address auto-increment */
+static int imx294_write_burst(struct imx294 *imx294, u16 reg, const u8 *vals,
+			      u32 len)
+{
+	enum imx294_xfer_type type = len <= 3 ? IMX294_XFER_WRITE1 + len - 1 :
+						IMX294_XFER_BURST;
+	unsigned int attempt;
+	ktime_t start;
+	int ret;
+
+	for (attempt = 0; ; attempt++) {
+		start = ktime_get();
+		ret = regmap_bulk_write(imx294->regmap, reg, vals, len);
+		imx294_account(imx294, type, len, start, ret);
+		if (!ret || !imx294_retry(imx294, type, attempt))
+			break;
+	}
+	/*
+	 * regmap updates the cache ahead of the transfer and keeps it on
+	 * failure, forget values the sensor may never have received
+	 */
+	if (ret)
+		regcache_drop_region(imx294->regmap, reg, reg + len - 1);
+
+	return ret;
+}
+
+/*
+ * Write a multi-byte register, LSB first. The write is skipped when the
+ * sensor already holds the value according to the register cache.
+ */
+static int imx294_write_reg(struct imx294 *imx294, u16 reg, u32 val, u32 len)
+{
+	u8 buf[4];
+	unsigned int i;
+
+	if (len > 4)
+		return -EINVAL;
+
+	for (i = 0; i < len; i++)
+		buf[i] = val >> (8 * i);
+
+	if (imx294_regs_cached(imx294, reg, buf, len))
+		return 0;
+
+	return imx294_write_burst(imx294, reg, buf, len);
+}
+
 /* Write registers 1 byte at a time */
 static int imx294_write_reg_1byte(struct imx294 *imx294, u16 reg, u8 val)
 {
-	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	u8 buf[3];
-
-	put_unaligned_be16(reg, buf);
-	buf[2]  = val;
-	if (i2c_master_send(client, buf, 3) != 3)
-		return -EIO;
+	return imx294_write_reg(imx294, reg, val, 1);
+}
 
-	return 0;
+/* Start an empty batch of register writes */
+static void imx294_batch_init(struct imx294_batch *batch)
+{
+	batch->num_msgs = 0;
+	batch->len = 0;
+	batch->err = 0;
 }
 
-/* Write registers 2 byte at a time */
-static int imx294_write_reg_2byte(struct imx294 *imx294, u16 reg, u16 val)
+static void imx294_batch_fill_msg(struct imx294 *imx294, struct i2c_msg *msg,
+				  u8 *buf, u16 len)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	u8 buf[4];
+
+	msg->addr = client->addr;
+	msg->flags = 0;
+	msg->len = len;
+	msg->buf = buf;
+}
+
+/*
+ * Queue a multi-byte register write, LSB first, as one message of the batch.
+ * Errors are latched and reported by imx294_batch_commit().
+ */
+static void imx294_batch_add(struct imx294 *imx294, struct imx294_batch *batch,
+			     u16 reg, u32 val, u32 len)
+{
+	u8 *buf = &batch->buf[batch->len];
+	unsigned int i;
+
+	if (batch->err)
+		return;
+
+	if (len > 4 || batch->num_msgs == IMX294_BATCH_MAX_MSGS ||
+	    batch->len + len + 2 > IMX294_BATCH_BUF_LEN) {
+		batch->err = -ENOSPC;
+		return;
+	}
 
 	put_unaligned_be16(reg, buf);
-	buf[2]  = val;
-	buf[3]  = val>>8;
-	if (i2c_master_send(client, buf, 4) != 4)
-		return -EIO;
+	for (i = 0; i < len; i++)
+		buf[2 + i] = val >> (8 * i);
 
-	return 0;
+	imx294_batch_fill_msg(imx294, &batch->msgs[1 + batch->num_msgs++],
+			      buf, len + 2);
+	batch->len += len + 2;
 }
 
-/* Write registers 3 byte at a time */
-static int imx294_write_reg_3byte(struct imx294 *imx294, u16 reg, u32 val)
+/*
+ * Send all queued writes in a single i2c_transfer(), so the adapter is
+ * locked once and the messages go out back to back with repeated STARTs.
+ * With @hold the writes are bracketed by REGHOLD, making the sensor latch
+ * them together at the same frame boundary. This applies to a single write
+ * too, as the bytes of a multi-byte register could otherwise be latched in
+ * different frames.
+ */
+static int imx294_batch_commit(struct imx294 *imx294,
+			       struct imx294_batch *batch, bool hold)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	u8 buf[5];
+	struct i2c_msg *writes = &batch->msgs[1];
+	struct i2c_msg *msgs = writes;
+	unsigned int num = batch->num_msgs;
+	unsigned int i, attempt;
+	ktime_t start;
+	int ret;
 
-	put_unaligned_be16(reg, buf);
-	buf[2]  = val;
-	buf[3]  = val>>8;
-	buf[4]  = val>>16;
-	if (i2c_master_send(client, buf, 5) != 5)
-		return -EIO;
+	if (batch->err)
+		return batch->err;
+
+	if (!batch->num_msgs)
+		return 0;
+
+	if (hold) {
+		put_unaligned_be16(IMX294_REG_REGHOLD, batch->hold_on);
+		batch->hold_on[2] = 1;
+		put_unaligned_be16(IMX294_REG_REGHOLD, batch->hold_off);
+		batch->hold_off[2] = 0;
+
+		imx294_batch_fill_msg(imx294, &batch->msgs[0],
+				      batch->hold_on, 3);
+		imx294_batch_fill_msg(imx294, &batch->msgs[1 + num],
+				      batch->hold_off, 3);
+		msgs = batch->msgs;
+		num += 2;
+	}
+
+	/* Register writes are idempotent, a retry resends the whole batch */
+	for (attempt = 0; ; attempt++) {
+		start = ktime_get();
+		ret = i2c_transfer(client->adapter, msgs, num);
+		imx294_account(imx294, IMX294_XFER_BATCH, batch->len, start,
+			       ret == num ? 0 : ret < 0 ? ret : -EIO);
+		if (ret == num ||
+		    !imx294_retry(imx294, IMX294_XFER_BATCH, attempt))
+			break;
+	}
+	if (ret != num) {
+		/* Unknown how far the transfer got, forget the cached values */
+		for (i = 0; i < batch->num_msgs; i++) {
+			u16 reg = get_unaligned_be16(writes[i].buf);
+
+			regcache_drop_region(imx294->regmap, reg,
+					     reg + writes[i].len - 3);
+		}
+
+		return ret < 0 ? ret : -EIO;
+	}
+
+	/* The writes bypassed regmap, mirror them into the register cache */
+	regcache_cache_only(imx294->regmap, true);
+	for (i = 0; i < batch->num_msgs; i++)
+		regmap_bulk_write(imx294->regmap,
+				  get_unaligned_be16(writes[i].buf),
+				  &writes[i].buf[2], writes[i].len - 2);
+	regcache_cache_only(imx294->regmap, false);
 
 	return 0;
 }
 
-/* Write a list of 1 byte registers */
-static int imx294_write_regs(struct imx294 *imx294,
-			     const struct imx294_reg *regs, u32 len)
+/*
+ * Read back a written burst, bypassing the cache, and compare. Volatile
+ * registers are skipped, their read value need not match what was written.
+ */
+static int imx294_verify_burst(struct imx294 *imx294, u16 reg, const u8 *vals,
+			       u32 len)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	unsigned int i;
+	u8 buf[IMX294_MAX_BURST_LEN];
+	unsigned int i, attempt;
+	ktime_t start;
 	int ret;
 
+	if (len > IMX294_MAX_BURST_LEN)
+		return -EINVAL;
+
+	regcache_cache_bypass(imx294->regmap, true);
+	for (attempt = 0; ; attempt++) {
+		start = ktime_get();
+		ret = regmap_bulk_read(imx294->regmap, reg, buf, len);
+		imx294_account(imx294, IMX294_XFER_READ, len, start, ret);
+		if (!ret || !imx294_retry(imx294, IMX294_XFER_READ, attempt))
+			break;
+	}
+	regcache_cache_bypass(imx294->regmap, false);
+	if (ret)
+		return ret;
+
 	for (i = 0; i < len; i++) {
-		if (regs[i].address == 0xFFFE) {
-			usleep_range(regs[i].val*1000,(regs[i].val+1)*1000);
+		if (regmap_reg_in_ranges(reg + i, imx294_volatile_ranges,
+					 ARRAY_SIZE(imx294_volatile_ranges)) ||
+		    buf[i] == vals[i])
+			continue;
+
+		imx294->verify_errors++;
+		dev_err_ratelimited(&client->dev,
+				    "reg 0x%4.4x reads 0x%02x, wrote 0x%02x\n",
+				    reg + i, buf[i], vals[i]);
+		ret = -EIO;
+	}
+
+	return ret;
+}
+
+/*
+ * Narrow a burst down to the span of registers whose values differ from the
+ * register cache. Returns the new length, 0 if nothing needs writing.
+ */
+static u32 imx294_trim_cached(struct imx294 *imx294, u16 *reg,
+			      const u8 **vals, u32 len)
+{
+	unsigned int i, cur, first = len, last = 0;
+
+	regcache_cache_only(imx294->regmap, true);
+	for (i = 0; i < len; i++) {
+		if (!regmap_read(imx294->regmap, *reg + i, &cur) &&
+		    cur == (*vals)[i])
+			continue;
+		if (first == len)
+			first = i;
+		last = i;
+	}
+	regcache_cache_only(imx294->regmap, false);
+
+	if (first == len)
+		return 0;
+
+	*reg += first;
+	*vals += first;
+
+	return last - first + 1;
+}
+
+/*
+ * Wait until @ms have passed since @anchor. The sensor exposes no status bit
+ * for PLL lock or standby release, so the wait ends at the sequence minimum;
+ * whatever was spent on register writes since the anchor is not slept again.
+ */
+static void imx294_settle(struct imx294 *imx294, ktime_t anchor, unsigned int ms)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	s64 elapsed = ktime_us_delta(ktime_get(), anchor);
+	s64 remaining = ms * USEC_PER_MSEC - elapsed;
+
+	if (remaining > 0) {
+		fsleep(remaining);
+		imx294->settle_us += remaining;
+	}
+	imx294->settle_waits++;
+
+	trace_imx294_settle(&client->dev, ms,
+			    min_t(s64, elapsed, ms * USEC_PER_MSEC),
+			    max_t(s64, remaining, 0));
+}
+
+/*
+ * Write a packed register table. Each record is retried
+ * on its own, so a transient failure resumes from the failing record instead
+ * of restarting the table. With @only_changed,
+ * registers already holding the table value are skipped, which turns a mode
+ * table into a differential update against whatever was programmed before.
+ */
+static int imx294_write_blob(struct imx294 *imx294,
+			     const struct imx294_reg_blob *blob,
+			     bool only_changed)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	const u8 *p = blob->data;
+	const u8 *end = blob->data + blob->len;
+	unsigned int regs = 0, bytes = 0;
+	const u8 *vals;
+	u32 len;
+	u16 reg;
+	int ret = 0;
+
+	while (p < end) {
+		if (p[0] == IMX294_BLOB_ANCHOR) {
+			imx294->settle_anchor = ktime_get();
+			p++;
+			continue;
 		}
-		else{
-			ret = imx294_write_reg_1byte(imx294, regs[i].address, regs[i].val);
-			if (ret) {
-				dev_err_ratelimited(&client->dev,
-						    "Failed to write reg 0x%4.4x. error = %d\n",
-						    regs[i].address, ret);
-
-				return ret;
-			}
+		if (p[0] == IMX294_BLOB_DELAY) {
+			imx294_settle(imx294, imx294->settle_anchor, p[1]);
+			p += 2;
+			continue;
 		}
+
+		reg = get_unaligned_be16(&p[1]);
+		vals = &p[3];
+		len = p[0];
+		p += 3 + len;
+
+		if (only_changed)
+			len = imx294_trim_cached(imx294, &reg, &vals, len);
+		if (!len)
+			continue;
+
+		ret = imx294_write_burst(imx294, reg, vals, len);
+		if (!ret && imx294->verify)
+			ret = imx294_verify_burst(imx294, reg, vals, len);
+		if (ret) {
+			dev_err_ratelimited(&client->dev,
+					    "Failed to write %u regs at 0x%4.4x. error = %d\n",
+					    len, reg, ret);
+			break;
+		}
+		regs += len;
+		bytes += 2 + len;
 	}
 
-	return 0;
+	trace_imx294_table(&client->dev, blob->name, regs, bytes, ret);
+
+	return ret;
 }
 
 /* Get bayer order based on flip setting. */
@@ -863,29 +1033,238 @@ static u32 imx294_get_format_code(struct imx294 *imx294, u32 code)
 	return codes[i];
 }
 
-static void imx294_set_default_format(struct imx294 *imx294)
+/* Look up a little-endian register value in a mode's table */
+static u32 imx294_mode_reg(const struct imx294_mode *mode, u16 reg,
+			   unsigned int len)
+{
+	const u8 *p = mode->blob.data;
+	const u8 *end = mode->blob.data + mode->blob.len;
+	unsigned int i, j;
+	u16 addr;
+	u32 val = 0;
+
+	while (p < end) {
+		if (p[0] == IMX294_BLOB_ANCHOR) {
+			p++;
+			continue;
+		}
+		if (p[0] == IMX294_BLOB_DELAY) {
+			p += 2;
+			continue;
+		}
+
+		addr = get_unaligned_be16(&p[1]);
+		for (i = 0; i < p[0]; i++)
+			for (j = 0; j < len; j++)
+				if (addr + i == reg + j)
+					val |= p[3 + i] << (8 * j);
+		p += 3 + p[0];
+	}
+
+	return val;
+}
+
+/*
+ * Offset of the mode's output frame in crop coordinates. The active area
+ * described by mode->crop sits centred in the output frame.
+ */
+static void imx294_window_origin(const struct imx294_mode *mode,
+				 int *left, int *top)
+{
+	*left = mode->crop.left - (mode->width - mode->crop.width) / 2;
+	*top = mode->crop.top - (mode->height - mode->crop.height) / 2;
+}
+
+/*
+ * Convert a crop request into a readout window of the current mode. The
+ * sensor trims lines only at the bottom, so the window always starts at the
+ * top of the frame and extends down far enough to cover the request.
+ */
+static void imx294_crop_to_window(const struct imx294_mode *mode,
+				  const struct v4l2_rect *r,
+				  struct v4l2_rect *win)
+{
+	int left, top;
+
+	imx294_window_origin(mode, &left, &top);
+
+	win->left = clamp_t(int, r->left - left, 0,
+			    mode->width - IMX294_WIN_MIN_WIDTH);
+	win->left = ALIGN_DOWN(win->left, IMX294_WIN_H_ALIGN);
+	win->width = clamp_t(int, ALIGN(r->left - left + r->width - win->left,
+					IMX294_WIN_H_ALIGN),
+			     IMX294_WIN_MIN_WIDTH, mode->width - win->left);
+
+	win->top = 0;
+	win->height = clamp_t(int, ALIGN(r->top - top + r->height,
+					 IMX294_WIN_V_ALIGN),
+			      IMX294_WIN_MIN_HEIGHT, mode->height);
+}
+
+/* The part of the active pixel area a readout window covers */
+static void imx294_window_to_crop(const struct imx294_mode *mode,
+				  const struct v4l2_rect *win,
+				  struct v4l2_rect *r)
+{
+	int left, top;
+
+	imx294_window_origin(mode, &left, &top);
+
+	r->left = max_t(int, left + win->left, mode->crop.left);
+	r->top = max_t(int, top + win->top, mode->crop.top);
+	r->width = min_t(int, left + win->left + win->width,
+			 mode->crop.left + mode->crop.width) - r->left;
+	r->height = min_t(int, top + win->top + win->height,
+			  mode->crop.top + mode->crop.height) - r->top;
+}
+
+/* Read out the whole output frame of the current mode */
+static void imx294_reset_window(struct imx294 *imx294)
+{
+	const struct imx294_mode *mode = imx294->mode;
+
+	imx294->win.left = 0;
+	imx294->win.top = 0;
+	imx294->win.width = mode->width;
+	imx294->win.height = mode->height;
+	imx294->crop = mode->crop;
+}
+
+/* Lines of vertical blanking the mode needs at minimum */
+static u32 imx294_min_vblank(const struct imx294_mode *mode)
+{
+	return mode->min_VMAX * mode->VMAX_scale - mode->height;
+}
+
+/* Program the readout window on top of the mode's full-frame settings */
+static int imx294_write_window(struct imx294 *imx294)
 {
+	const struct imx294_mode *mode = imx294->mode;
+	u32 hstart, vsize;
+	int ret;
+
+	hstart = imx294_mode_reg(mode, IMX294_REG_HTRIMMING_START, 2) +
+		 imx294->win.left;
+	vsize = imx294_mode_reg(mode, IMX294_REG_WRITE_VSIZE, 2) -
+		(mode->height - imx294->win.height);
+
+	ret = imx294_write_reg(imx294, IMX294_REG_HTRIMMING_START, hstart, 2);
+	if (!ret)
+		ret = imx294_write_reg(imx294, IMX294_REG_HTRIMMING_END,
+				       hstart + imx294->win.width, 2);
+	if (!ret)
+		ret = imx294_write_reg(imx294, IMX294_REG_WRITE_VSIZE, vsize, 2);
+	if (!ret)
+		ret = imx294_write_reg(imx294, IMX294_REG_Y_OUT_SIZE, vsize -
+				       imx294_mode_reg(mode, IMX294_REG_OPB_SIZE_V, 1),
+				       2);
+
+	return ret;
+}
+
+/* Minimum VMAX for the current readout window */
+static u32 imx294_min_vmax(struct imx294 *imx294)
+{
+	const struct imx294_mode *mode = imx294->mode;
+
+	return DIV_ROUND_UP(imx294->win.height + imx294_min_vblank(mode),
+			    (u32)mode->VMAX_scale);
+}
+
+/*
+ * Pick the format and frame rate the sensor starts out with, so a deployment
+ * running a single configuration does not need to renegotiate it after boot.
+ * Module parameters take precedence over the DT properties.
+ */
+static void imx294_parse_defaults(struct imx294 *imx294)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	struct device *dev = &client->dev;
+	const char *mode_name = default_mode;
+	const char *bayer = default_bayer;
+	u32 fps = default_fps;
+	unsigned int i;
+	int ret;
+
+	if (!mode_name)
+		device_property_read_string(dev, "sony,default-mode", &mode_name);
+	if (!bayer)
+		device_property_read_string(dev, "sony,default-bayer-order",
+					    &bayer);
+	if (!fps)
+		device_property_read_u32(dev, "sony,default-fps", &fps);
+
 	/* Set default mode to max resolution */
-	imx294->mode = &supported_modes_12bit[0];
-	imx294->fmt_code = MEDIA_BUS_FMT_SGBRG12_1X12;
+	imx294->init_mode = &supported_modes_12bit[0];
+	if (mode_name) {
+		for (i = 0; i < ARRAY_SIZE(supported_modes_12bit); i++)
+			if (!strcasecmp(mode_name, supported_modes_12bit[i].name))
+				break;
+		if (i < ARRAY_SIZE(supported_modes_12bit))
+			imx294->init_mode = &supported_modes_12bit[i];
+		else
+			dev_warn(dev, "unknown default mode %s\n", mode_name);
+	}
+
+	imx294->init_code = MEDIA_BUS_FMT_SGBRG12_1X12;
+	if (bayer) {
+		ret = match_string(imx294_bayer_names,
+				   ARRAY_SIZE(imx294_bayer_names), bayer);
+		if (ret >= 0)
+			imx294->init_code = codes[ret];
+		else
+			dev_warn(dev, "unknown default bayer order %s\n", bayer);
+	}
+
+	imx294->init_fps = fps;
+}
+
+static void imx294_set_default_format(struct imx294 *imx294)
+{
+	imx294->mode = imx294->init_mode;
+	imx294->fmt_code = imx294->init_code;
+	imx294_reset_window(imx294);
+}
+
+/*
+ * Frame period in HV clocks for the frame rate asked for at probe, or the
+ * mode default. The framing policy decides how it is split into HMAX/VMAX.
+ */
+static u64 imx294_default_period(struct imx294 *imx294,
+				 const struct imx294_mode *mode)
+{
+	if (imx294->init_fps)
+		return div_u64(IMX294_HV_CLK_FREQ, imx294->init_fps);
+
+	return mode->default_HMAX * mode->default_VMAX;
 }
 
 static int imx294_open(struct v4l2_subdev *sd, struct v4l2_subdev_fh *fh)
 {
+	struct i2c_client *client = v4l2_get_subdevdata(sd);
 	struct imx294 *imx294 = to_imx294(sd);
 	struct v4l2_mbus_framefmt *try_fmt_img =
 		v4l2_subdev_get_try_format(sd, fh->state, IMAGE_PAD);
 	struct v4l2_mbus_framefmt *try_fmt_meta =
 		v4l2_subdev_get_try_format(sd, fh->state, METADATA_PAD);
 	struct v4l2_rect *try_crop;
+	int ret;
+
+	/* Probe may have left identification to the first power-up */
+	if (!imx294->identified) {
+		ret = pm_runtime_resume_and_get(&client->dev);
+		if (ret < 0)
+			return ret;
+		pm_runtime_mark_last_busy(&client->dev);
+		pm_runtime_put_autosuspend(&client->dev);
+	}
 
 	mutex_lock(&imx294->mutex);
 
 	/* Initialize try_fmt for the image pad */
-	try_fmt_img->width = supported_modes_12bit[0].width;
-	try_fmt_img->height = supported_modes_12bit[0].height;
-	try_fmt_img->code = imx294_get_format_code(imx294,
-						   MEDIA_BUS_FMT_SGBRG12_1X12);
+	try_fmt_img->width = imx294->init_mode->width;
+	try_fmt_img->height = imx294->init_mode->height;
+	try_fmt_img->code = imx294_get_format_code(imx294, imx294->init_code);
 	try_fmt_img->field = V4L2_FIELD_NONE;
 
 	/* Initialize try_fmt for the embedded metadata pad */
@@ -943,15 +1322,365 @@ static uint32_t calculate_shr(uint32_t exposure, uint32_t hmax, uint64_t vmax, u
     return shr;
 }
 
+/* Start collecting the register writes of a control update */
+static void imx294_ctrl_batch_begin(struct imx294 *imx294)
+{
+	imx294_batch_init(&imx294->batch);
+	imx294->pending = imx294->shadow;
+}
+
+/* Apply a control update to the sensor as one REGHOLD-bracketed transfer */
+static int imx294_ctrl_batch_commit(struct imx294 *imx294)
+{
+	int ret;
+
+	ret = imx294_batch_commit(imx294, &imx294->batch, true);
+	if (ret)
+		imx294_shadow_invalidate(imx294);
+	else
+		imx294->shadow = imx294->pending;
+
+	return ret;
+}
+
+/*
+ * Queue SHR for @exposure lines. SHR counts from the end of the frame, so it
+ * has to be rewritten whenever VMAX or HMAX change as well.
+ */
+static void imx294_queue_shr(struct imx294 *imx294, u32 exposure)
+{
+	const struct imx294_mode *mode = imx294->mode;
+	u32 shr;
+
+	shr = calculate_shr(exposure, imx294->HMAX, imx294->VMAX, 0,
+			    mode->integration_offset);
+	DEBUG_PRINTK("\tSHR:%d\n",shr);
+	if (shr == imx294->pending.shr)
+		return;
+
+	imx294_batch_add(imx294, &imx294->batch, IMX294_REG_SHR, shr, 2);
+	imx294->pending.shr = shr;
+}
+
+static void imx294_queue_gain(struct imx294 *imx294, u32 gain)
+{
+	if (gain == imx294->pending.gain)
+		return;
+
+	imx294_batch_add(imx294, &imx294->batch, IMX294_REG_ANALOG_GAIN, gain, 2);
+	imx294->pending.gain = gain;
+}
+
+/* Queue VMAX and the PSSLVS registers derived from it */
+static void imx294_queue_vmax(struct imx294 *imx294)
+{
+	struct imx294_batch *batch = &imx294->batch;
+	u32 vblk;
+
+	if (imx294->VMAX != imx294->pending.vmax) {
+		imx294_batch_add(imx294, batch, IMX294_REG_VMAX,
+				 imx294->VMAX, 3);
+		imx294->pending.vmax = imx294->VMAX;
+	}
+
+	/* The minimum VMAX follows the mode and window, not VMAX alone */
+	vblk = imx294->VMAX - imx294_min_vmax(imx294);
+	if (vblk == imx294->pending.vblk)
+		return;
+
+	DEBUG_PRINTK("\tvblk : %d\n",vblk);
+	imx294_batch_add(imx294, batch, IMX294_REG_PSSLVS1, vblk, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_PSSLVS2, vblk, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_PSSLVS3, vblk, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_PSSLVS4,
+			 vblk <= 5 ? 0 : vblk - 5, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_PSSLVS0, vblk, 2);
+	imx294->pending.vblk = vblk;
+}
+
+/* Queue HMAX and the HCOUNT registers that must match it */
+static void imx294_queue_hmax(struct imx294 *imx294)
+{
+	struct imx294_batch *batch = &imx294->batch;
+
+	if (imx294->HMAX == imx294->pending.hmax)
+		return;
+
+	imx294_batch_add(imx294, batch, IMX294_REG_HMAX, imx294->HMAX, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_HCOUNT1, imx294->HMAX, 2);
+	imx294_batch_add(imx294, batch, IMX294_REG_HCOUNT2, imx294->HMAX, 2);
+	imx294->pending.hmax = imx294->HMAX;
+}
+
+/* Queue every timing register from the current control values */
+static void imx294_queue_timing(struct imx294 *imx294)
+{
+	imx294_queue_hmax(imx294);
+	imx294_queue_vmax(imx294);
+	imx294_queue_shr(imx294, imx294->exposure->cur.val);
+	imx294_queue_gain(imx294, imx294->gain->cur.val);
+}
+
+/*
+ * Async control mode: s_ctrl only records the new values, this worker then
+ * writes whatever is latest in one batch. Updates arriving before it runs
+ * collapse into a single bus transfer.
+ */
+static void imx294_ctrl_work(struct kthread_work *work)
+{
+	struct imx294 *imx294 = container_of(work, struct imx294, ctrl_work);
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	int ret;
+
+	mutex_lock(&imx294->mutex);
+
+	if (!imx294->ctrl_dirty || !imx294->streaming)
+		goto unlock;
+	imx294->ctrl_dirty = false;
+
+	if (pm_runtime_get_if_in_use(&client->dev) <= 0)
+		goto unlock;
+
+	imx294_ctrl_batch_begin(imx294);
+	imx294_queue_timing(imx294);
+	ret = imx294_ctrl_batch_commit(imx294);
+	if (ret)
+		dev_err_ratelimited(&client->dev,
+				    "failed to apply controls: %d\n", ret);
+
+	pm_runtime_put(&client->dev);
+
+unlock:
+	mutex_unlock(&imx294->mutex);
+}
+
+/*
+ * Pixel rate HBLANK is counted in: the window width is read out in min_HMAX
+ * HV clocks. PIXEL_RATE reports VMAX_scale times this, as VBLANK counts
+ * VMAX_scale lines per VMAX unit.
+ */
+static u64 imx294_line_pixel_rate(struct imx294 *imx294)
+{
+	return div_u64((u64)imx294->win.width * IMX294_HV_CLK_FREQ,
+		       imx294->mode->min_HMAX);
+}
+
+/* HMAX resulting from an HBLANK control value */
+static u32 imx294_hblank_to_hmax(struct imx294 *imx294, u32 hblank)
+{
+	return div64_u64((u64)(imx294->win.width + hblank) * IMX294_HV_CLK_FREQ,
+			 imx294_line_pixel_rate(imx294));
+}
+
+/* Smallest HBLANK control value giving at least @hmax */
+static u32 imx294_hmax_to_hblank(struct imx294 *imx294, u32 hmax)
+{
+	u64 line = DIV64_U64_ROUND_UP((u64)hmax * imx294_line_pixel_rate(imx294),
+				      IMX294_HV_CLK_FREQ);
+
+	return line > imx294->win.width ? line - imx294->win.width : 0;
+}
+
+/* Frame period of an HMAX/VMAX pair as a fraction of a second */
+static void imx294_timing_to_interval(u32 hmax, u32 vmax,
+				      struct v4l2_fract *interval)
+{
+	u64 clocks = (u64)hmax * vmax;
+	u32 rem, div;
+
+	div_u64_rem(clocks, IMX294_HV_CLK_FREQ, &rem);
+	div = gcd(rem, IMX294_HV_CLK_FREQ);
+	clocks = div_u64(clocks, div);
+	div = IMX294_HV_CLK_FREQ / div;
+
+	/* Only frame periods of about a minute and longer get rounded */
+	while (clocks > U32_MAX) {
+		clocks >>= 1;
+		div >>= 1;
+	}
+
+	interval->numerator = clocks;
+	interval->denominator = div;
+}
+
+/*
+ * Smallest HMAX in [@lo, @hi], below @best if set, that HBLANK can express
+ * and that is @factor times a divisor of @smooth. @smooth divides the 72 MHz
+ * clock, so its divisors are all of the form 2^i * 3^j * 5^k.
+ */
+static u32 imx294_exact_hmax(struct imx294 *imx294, u32 smooth, u32 factor,
+			     u64 lo, u64 hi, u32 best)
+{
+	u32 s2, s3, s;
+	u64 hmax;
+
+	for (s2 = 1; smooth % s2 == 0; s2 *= 2)
+		for (s3 = s2; smooth % s3 == 0; s3 *= 3)
+			for (s = s3; smooth % s == 0; s *= 5) {
+				hmax = (u64)factor * s;
+				if (hmax < lo || hmax > hi || (best && hmax >= best))
+					continue;
+
+				/* Narrow windows cannot hit every HMAX through HBLANK */
+				if (imx294_hblank_to_hmax(imx294,
+						imx294_hmax_to_hblank(imx294, hmax)) != hmax)
+					continue;
+
+				best = hmax;
+			}
+
+	return best;
+}
+
+/*
+ * Find an HMAX/VMAX pair for @interval within the limits of the current mode
+ * and readout window. An exact period is a divisor pair of its clock count:
+ * the divisors of the reduced numerator are found by trial division and
+ * combined with those of 72 MHz / denominator. Of the exact pairs the one
+ * with the smallest HMAX wins, it leaves the finest exposure steps. Without
+ * one, HMAX is searched upwards for the pair closest to the period, stopping
+ * early once within 1 ppm.
+ */
+static void imx294_solve_interval(struct imx294 *imx294,
+				  const struct v4l2_fract *interval,
+				  u32 *best_hmax, u32 *best_vmax)
+{
+	u32 num = interval->numerator, den = interval->denominator ?: 1;
+	u32 hmin = imx294_hblank_to_hmax(imx294, imx294->hblank->minimum);
+	u32 hmax_hi = min_t(u32, IMX294_HMAX_MAX,
+			    imx294_hblank_to_hmax(imx294, imx294->hblank->maximum));
+	u32 vmin = imx294_min_vmax(imx294);
+	u32 g, i, hblank, vmax, best = 0;
+	u64 target, lo, hi, hmax, clocks, err, best_err;
+
+	g = gcd(num, den);
+	num /= g;
+	den /= g;
+
+	/* Frame period in clocks, times den */
+	target = (u64)num * IMX294_HV_CLK_FREQ;
+
+	/* HMAX range where some VMAX within the limits gives the period */
+	lo = max_t(u64, hmin, DIV64_U64_ROUND_UP(target,
+						 (u64)den * IMX294_VMAX_MAX));
+	lo = min_t(u64, lo, hmax_hi);
+	hi = min_t(u64, hmax_hi, div64_u64(target, (u64)den * vmin));
+
+	/* An exact period needs a whole number of clocks */
+	if (num && IMX294_HV_CLK_FREQ % den == 0) {
+		for (i = 1; i <= num / i; i++) {
+			if (num % i)
+				continue;
+			best = imx294_exact_hmax(imx294, IMX294_HV_CLK_FREQ / den,
+						 i, lo, hi, best);
+			best = imx294_exact_hmax(imx294, IMX294_HV_CLK_FREQ / den,
+						 num / i, lo, hi, best);
+		}
+	}
+
+	if (best) {
+		*best_hmax = best;
+		*best_vmax = div64_u64(target, (u64)best * den);
+		return;
+	}
+
+	/* Shortest usable line, for periods out of range of the limits */
+	hblank = min_t(u32, imx294_hmax_to_hblank(imx294, lo),
+		       imx294->hblank->maximum);
+	*best_hmax = imx294_hblank_to_hmax(imx294, hblank);
+	*best_vmax = clamp_t(u64, DIV64_U64_ROUND_CLOSEST(target,
+				(u64)*best_hmax * den), vmin, IMX294_VMAX_MAX);
+	clocks = (u64)*best_hmax * *best_vmax * den;
+	best_err = clocks > target ? clocks - target : target - clocks;
+
+	for (hmax = lo; hmax <= hi; hmax++) {
+		if (best_err <= div_u64(target, 1000000))
+			break;
+
+		/* Narrow windows cannot hit every HMAX through HBLANK */
+		if (imx294_hblank_to_hmax(imx294,
+					  imx294_hmax_to_hblank(imx294, hmax)) != hmax)
+			continue;
+
+		/* [lo, hi] keeps the rounded VMAX within its limits */
+		vmax = DIV64_U64_ROUND_CLOSEST(target, hmax * den);
+		clocks = hmax * vmax * den;
+		err = clocks > target ? clocks - target : target - clocks;
+		if (err < best_err) {
+			best_err = err;
+			*best_hmax = hmax;
+			*best_vmax = vmax;
+		}
+	}
+}
+
+/* Rolling shutter skew: time between reading the first and last line */
+static void imx294_update_readout_time(struct imx294 *imx294)
+{
+	u64 us = (u64)imx294->win.height * imx294->HMAX;
+
+	us = div_u64(us, (IMX294_HV_CLK_FREQ / USEC_PER_SEC) *
+			 (u32)imx294->mode->VMAX_scale);
+	__v4l2_ctrl_s_ctrl(imx294->readout_time, us);
+}
+
+/* HBLANK giving the mode's default line time */
+static u32 imx294_default_hblank(struct imx294 *imx294)
+{
+	return imx294_hmax_to_hblank(imx294, imx294->mode->default_HMAX);
+}
+
+/*
+ * Set up the blanking controls for the framing policy, at a frame period of
+ * @period HV clocks. The line time is the mode default or the minimum, VMAX
+ * takes the rest of the period.
+ */
+static void imx294_apply_framing_policy(struct imx294 *imx294, u64 period)
+{
+	const struct imx294_mode *mode = imx294->mode;
+	u32 height = imx294->win.height;
+	u32 hblank, hblank_max, vmax;
+
+	if (imx294->policy == IMX294_FRAMING_MIN_LINE) {
+		hblank = 0;
+		hblank_max = 0;
+	} else {
+		hblank = imx294_default_hblank(imx294);
+		hblank_max = IMX294_HMAX_MAX;
+	}
+
+	__v4l2_ctrl_modify_range(imx294->hblank, 0, hblank_max, 1, hblank);
+	/* The control may already hold the value, s_ctrl then does not run */
+	imx294->HMAX = imx294_hblank_to_hmax(imx294, hblank);
+	__v4l2_ctrl_s_ctrl(imx294->hblank, hblank);
+
+	vmax = clamp_t(u64, DIV_ROUND_CLOSEST_ULL(period, imx294->HMAX),
+		       imx294_min_vmax(imx294), IMX294_VMAX_MAX);
+	imx294->VMAX = vmax;
+	__v4l2_ctrl_modify_range(imx294->vblank, imx294_min_vblank(mode),
+				 IMX294_VMAX_MAX * mode->VMAX_scale - height,
+				 1, vmax * mode->VMAX_scale - height);
+	__v4l2_ctrl_s_ctrl(imx294->vblank, vmax * mode->VMAX_scale - height);
+
+	imx294_update_readout_time(imx294);
+}
+
 static int imx294_set_ctrl(struct v4l2_ctrl *ctrl)
 {
 	struct imx294 *imx294 =
 		container_of(ctrl->handler, struct imx294, ctrl_handler);
 	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
 	const struct imx294_mode *mode = imx294->mode;
-    u64 shr, vblk, tmp;
+    u64 tmp;
 	int ret = 0;
 
+	/*
+	 * All writes of a control cluster, including those of controls updated
+	 * as a side effect below, are committed together by the outermost call.
+	 */
+	if (!imx294->ctrl_depth++)
+		imx294_ctrl_batch_begin(imx294);
+
 	/*
 	 * The VBLANK control may change the limits of usable exposure, so check
 	 * and adjust if necessary.
@@ -960,79 +1689,84 @@ static int imx294_set_ctrl(struct v4l2_ctrl *ctrl)
 		/* Honour the VBLANK limits when setting exposure. */
 		u64 current_exposure, max_exposure, min_exposure, vmax;
 
-        vmax = ((u64)mode->height + ctrl->val);
+        vmax = ((u64)imx294->win.height + ctrl->val);
         do_div(vmax, mode->VMAX_scale);
 
 		imx294 -> VMAX = vmax;
 		
 		calculate_min_max_v4l2_cid_exposure(imx294 -> HMAX, imx294 -> VMAX, (u64)mode->min_SHR, 0, mode->integration_offset, &min_exposure, &max_exposure);
-		current_exposure = clamp_t(uint32_t, current_exposure, min_exposure, max_exposure);
+		current_exposure = clamp_t(uint32_t, imx294->exposure->val, min_exposure, max_exposure);
 
 		DEBUG_PRINTK("exposure_max:%lld, exposure_min:%lld, current_exposure:%lld\n",max_exposure, min_exposure, current_exposure);
 		DEBUG_PRINTK("\tVMAX:%d, HMAX:%d\n",imx294->VMAX, imx294->HMAX);
 		__v4l2_ctrl_modify_range(imx294->exposure, min_exposure,max_exposure, 1,current_exposure);
 	}
 
+	if (ctrl->id == V4L2_CID_HBLANK) {
+		imx294->HMAX = imx294_hblank_to_hmax(imx294, ctrl->val);
+		imx294_update_readout_time(imx294);
+	}
+
+	/* Keep the current frame period, moving the slack into VMAX */
+	if (ctrl->id == V4L2_CID_IMX294_FRAMING_POLICY) {
+		imx294->policy = ctrl->val;
+		imx294_apply_framing_policy(imx294,
+					    (u64)imx294->HMAX * imx294->VMAX);
+	}
+
+	/* In async mode the worker writes the latest values once it runs */
+	if (imx294->ctrl_worker && imx294->streaming) {
+		imx294->ctrl_dirty = true;
+		kthread_queue_work(imx294->ctrl_worker, &imx294->ctrl_work);
+		goto out;
+	}
+
 	/*
 	 * Applying V4L2 control value only happens
 	 * when power is up for streaming
 	 */
 	if (pm_runtime_get_if_in_use(&client->dev) == 0)
-		return 0;
+		goto out;
 
-	
 	switch (ctrl->id) {
 	case V4L2_CID_EXPOSURE:
-		{
-		DEBUG_PRINTK("V4L2_CID_EXPOSURE : %d\n",ctrl->val);
-		DEBUG_PRINTK("\tvblank:%d, hblank:%d\n",imx294->vblank->val, imx294->hblank->val);
-		DEBUG_PRINTK("\tVMAX:%d, HMAX:%d\n",imx294->VMAX, imx294->HMAX);
-		shr = calculate_shr(ctrl->val, imx294->HMAX, imx294->VMAX, 0, mode->integration_offset);
-		DEBUG_PRINTK("\tSHR:%lld\n",shr);
-		ret = imx294_write_reg_2byte(imx294, IMX294_REG_SHR, shr);
+		/* Exposure is the master of the exposure/gain cluster */
+		if (imx294->exposure->is_new) {
+			DEBUG_PRINTK("V4L2_CID_EXPOSURE : %d\n",ctrl->val);
+			DEBUG_PRINTK("\tvblank:%d, hblank:%d\n",imx294->vblank->val, imx294->hblank->val);
+			DEBUG_PRINTK("\tVMAX:%d, HMAX:%d\n",imx294->VMAX, imx294->HMAX);
+			imx294_queue_shr(imx294, ctrl->val);
+		}
+		if (imx294->gain->is_new) {
+			DEBUG_PRINTK("V4L2_CID_ANALOGUE_GAIN : %d\n",imx294->gain->val);
+			imx294_queue_gain(imx294, imx294->gain->val);
 		}
-		break;
-	case V4L2_CID_ANALOGUE_GAIN:
-		DEBUG_PRINTK("V4L2_CID_ANALOGUE_GAIN : %d\n",ctrl->val);
-		ret = imx294_write_reg_2byte(imx294, IMX294_REG_ANALOG_GAIN, ctrl->val);
 		break;
 	case V4L2_CID_VBLANK:
 		{
 		DEBUG_PRINTK("V4L2_CID_VBLANK : %d\n",ctrl->val);
-        tmp = ((u64)mode->height + ctrl->val);
+        tmp = ((u64)imx294->win.height + ctrl->val);
         do_div(tmp, mode->VMAX_scale);
 		imx294 -> VMAX = tmp;
 		DEBUG_PRINTK("\tVMAX : %d\n",imx294 -> VMAX);
-		ret = imx294_write_reg_3byte(imx294, IMX294_REG_VMAX, imx294 -> VMAX);
-        vblk = imx294 -> VMAX  - mode-> min_VMAX;
-        DEBUG_PRINTK("\tvblk : %d\n",vblk);
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS1, vblk);
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS2, vblk);
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS3, vblk);
-        if(vblk <= 5){
-            ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS4, 0);
-        }
-        else{
-            ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS4, vblk - 5);
-        }
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_PSSLVS0, vblk);
+		imx294_queue_vmax(imx294);
+		imx294_queue_shr(imx294, imx294->exposure->val);
 		}
 		break;
 	case V4L2_CID_HBLANK:
 		{
 		DEBUG_PRINTK("V4L2_CID_HBLANK : %d\n",ctrl->val);
-		//int hmax = (IMX294_NATIVE_WIDTH + ctrl->val) * 72000000; / IMX294_PIXEL_RATE;
-		u64 pixel_rate = (u64)mode->width * 72000000;
-		do_div(pixel_rate,mode->min_HMAX);
-		u64 hmax = (u64)(mode->width + ctrl->val) * 72000000;
-		do_div(hmax,pixel_rate);
-		imx294 -> HMAX = hmax;
 		DEBUG_PRINTK("\tHMAX : %d\n",imx294 -> HMAX);
-		ret = imx294_write_reg_2byte(imx294, IMX294_REG_HMAX, hmax);
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_HCOUNT1, hmax);
-        ret = imx294_write_reg_2byte(imx294, IMX294_REG_HCOUNT2, hmax);
+		imx294_queue_hmax(imx294);
+		imx294_queue_shr(imx294, imx294->exposure->val);
 		}
 		break;
+	case V4L2_CID_IMX294_FRAMING_POLICY:
+		/* The blanking controls updated above queued the registers */
+		break;
+	case V4L2_CID_PIXEL_RATE:
+		/* Read-only, its range follows the mode and window width */
+		break;
 	default:
 		dev_err(&client->dev,
 			 "ctrl(id:0x%x,val:0x%x) is not handled\n",
@@ -1041,8 +1775,14 @@ static int imx294_set_ctrl(struct v4l2_ctrl *ctrl)
 		break;
 	}
 
+	if (!ret && imx294->ctrl_depth == 1)
+		ret = imx294_ctrl_batch_commit(imx294);
+
 	pm_runtime_put(&client->dev);
 
+out:
+	imx294->ctrl_depth--;
+
 	return ret;
 }
 
@@ -1050,6 +1790,31 @@ static const struct v4l2_ctrl_ops imx294_ctrl_ops = {
 	.s_ctrl = imx294_set_ctrl,
 };
 
+static const char * const imx294_framing_policy_menu[] = {
+	"Default Line Time",
+	"Minimum Line Time",
+};
+
+static const struct v4l2_ctrl_config imx294_framing_policy_ctrl = {
+	.ops = &imx294_ctrl_ops,
+	.id = V4L2_CID_IMX294_FRAMING_POLICY,
+	.name = "Framing Policy",
+	.type = V4L2_CTRL_TYPE_MENU,
+	.max = ARRAY_SIZE(imx294_framing_policy_menu) - 1,
+	.def = IMX294_FRAMING_DEFAULT_LINE,
+	.qmenu = imx294_framing_policy_menu,
+};
+
+/* Driver-updated only, no ops so updates do not reach imx294_set_ctrl() */
+static const struct v4l2_ctrl_config imx294_readout_time_ctrl = {
+	.id = V4L2_CID_IMX294_READOUT_TIME,
+	.name = "Readout Time (us)",
+	.type = V4L2_CTRL_TYPE_INTEGER,
+	.flags = V4L2_CTRL_FLAG_READ_ONLY,
+	.max = S32_MAX,
+	.step = 1,
+};
+
 static int imx294_enum_mbus_code(struct v4l2_subdev *sd,
 				 struct v4l2_subdev_state *sd_state,
 				 struct v4l2_subdev_mbus_code_enum *code)
@@ -1165,6 +1930,8 @@ static int imx294_get_pad_format(struct v4l2_subdev *sd,
 		if (fmt->pad == IMAGE_PAD) {
 			imx294_update_image_pad_format(imx294, imx294->mode,
 						       fmt);
+			fmt->format.width = imx294->win.width;
+			fmt->format.height = imx294->win.height;
 			fmt->format.code =
 			       imx294_get_format_code(imx294, imx294->fmt_code);
 		} else {
@@ -1180,42 +1947,106 @@ static int imx294_get_pad_format(struct v4l2_subdev *sd,
 static void imx294_set_framing_limits(struct imx294 *imx294)
 {
 	const struct imx294_mode *mode = imx294->mode;
-	u64 def_hblank;
 	u64 pixel_rate;
 
 
-	imx294->VMAX = mode->default_VMAX;
-	imx294->HMAX = mode->default_HMAX;
-
-	pixel_rate = (u64)mode->width * 72000000 * 2;
-	do_div(pixel_rate,mode->min_HMAX);
+	pixel_rate = imx294_line_pixel_rate(imx294) * mode->VMAX_scale;
 	DEBUG_PRINTK("Pixel Rate : %lld\n",pixel_rate);
 
 
-	//int def_hblank = mode->default_HMAX * IMX294_PIXEL_RATE / 72000000 - IMX294_NATIVE_WIDTH;
-	def_hblank = mode->default_HMAX * pixel_rate;
-	do_div(def_hblank,72000000);
-	def_hblank = def_hblank - mode->width;
-	__v4l2_ctrl_modify_range(imx294->hblank, 0,
-				 IMX294_HMAX_MAX, 1, def_hblank);
+	/* Update limits and set FPS to default */
+	imx294_apply_framing_policy(imx294,
+				    imx294_default_period(imx294, mode));
+
+	/* Setting this will adjust the exposure limits as well. */
+
+	__v4l2_ctrl_modify_range(imx294->pixel_rate, pixel_rate, pixel_rate, 1, pixel_rate);
+
+	DEBUG_PRINTK("Setting default HBLANK : %d, VBLANK : %d with PixelRate: %lld\n",imx294->hblank->val,imx294->vblank->val, pixel_rate);
+
+}
+
+/* Forget the programmed register state, the sensor no longer holds it */
+static void imx294_drop_programmed_state(struct imx294 *imx294)
+{
+	imx294->programmed_mode = NULL;
+	imx294_shadow_invalidate(imx294);
+
+	/* Register contents are lost, don't let the cache skip any writes. */
+	regcache_drop_region(imx294->regmap, 0, IMX294_REG_MAX);
+}
+
+/* Stop streaming */
+static void imx294_stop_streaming(struct imx294 *imx294)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	int ret;
+
+	/* set stream off register */
+	ret = imx294_write_reg_1byte(imx294, IMX294_REG_MODE_SELECT, IMX294_MODE_STANDBY);
+	if (ret)
+		dev_err(&client->dev, "%s failed to set stream\n", __func__);
+}
 
+/*
+ * Give up on a stream whose sensor state is no longer known, such as after a
+ * failed mode switch. The sensor is left in standby and every register is
+ * written again on the next stream on.
+ */
+static void imx294_abort_streaming(struct imx294 *imx294)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
 
-	__v4l2_ctrl_s_ctrl(imx294->hblank, def_hblank);
+	imx294_stop_streaming(imx294);
+	imx294_drop_programmed_state(imx294);
+	imx294->streaming = false;
 
+	pm_runtime_mark_last_busy(&client->dev);
+	pm_runtime_put_autosuspend(&client->dev);
+}
 
+/*
+ * Move a streaming sensor to imx294->mode without a stream restart. The
+ * sensor only drops to standby for the differential mode registers and the
+ * new frame timing, which go out as one batch.
+ */
+static int imx294_switch_mode(struct imx294 *imx294)
+{
+	int ret;
 
-	/* Update limits and set FPS to default */
-	__v4l2_ctrl_modify_range(imx294->vblank, mode->min_VMAX*mode->VMAX_scale - mode->height,
-				 IMX294_VMAX_MAX*mode->VMAX_scale - mode->height,
-				 1, mode->default_VMAX*mode->VMAX_scale - mode->height);
-	__v4l2_ctrl_s_ctrl(imx294->vblank, mode->default_VMAX*mode->VMAX_scale - mode->height);
+	ret = imx294_write_reg_1byte(imx294, IMX294_REG_MODE_SELECT,
+				     IMX294_MODE_STANDBY);
+	if (ret)
+		return ret;
 
-	/* Setting this will adjust the exposure limits as well. */
+	ret = imx294_write_blob(imx294, &imx294->mode->blob,
+				true);
+	if (ret) {
+		imx294->programmed_mode = NULL;
+		return ret;
+	}
+	imx294->programmed_mode = imx294->mode;
 
-	__v4l2_ctrl_modify_range(imx294->pixel_rate, pixel_rate, pixel_rate, 1, pixel_rate);
+	ret = imx294_write_window(imx294);
+	if (ret)
+		return ret;
 
-	DEBUG_PRINTK("Setting default HBLANK : %lld, VBLANK : %lld with PixelRate: %lld\n",def_hblank,mode->default_VMAX*mode->VMAX_scale - mode->height, pixel_rate);
+	/*
+	 * The control updates from the new framing limits are queued into this
+	 * batch by the nested s_ctrl calls, which neither begin nor commit it.
+	 */
+	imx294_ctrl_batch_begin(imx294);
+	imx294->ctrl_depth++;
+	imx294_set_framing_limits(imx294);
+	imx294->ctrl_depth--;
+	imx294_queue_timing(imx294);
+	ret = imx294_ctrl_batch_commit(imx294);
+	imx294->ctrl_dirty = false;
+	if (ret)
+		return ret;
 
+	return imx294_write_reg_1byte(imx294, IMX294_REG_MODE_SELECT,
+				      IMX294_MODE_STREAMING);
 }
 /* TODO */
 static int imx294_set_pad_format(struct v4l2_subdev *sd,
@@ -1225,6 +2056,8 @@ static int imx294_set_pad_format(struct v4l2_subdev *sd,
 	struct v4l2_mbus_framefmt *framefmt;
 	const struct imx294_mode *mode;
 	struct imx294 *imx294 = to_imx294(sd);
+	struct i2c_client *client = v4l2_get_subdevdata(sd);
+	int ret = 0;
 
 	if (fmt->pad >= NUM_PADS)
 		return -EINVAL;
@@ -1241,20 +2074,60 @@ static int imx294_set_pad_format(struct v4l2_subdev *sd,
 
 		get_mode_table(fmt->format.code, &mode_list, &num_modes);
 
-		mode = v4l2_find_nearest_size(mode_list,
-					      num_modes,
-					      width, height,
-					      fmt->format.width,
-					      fmt->format.height);
+		/*
+		 * The pad reports the readout window after a crop. Handing
+		 * that format back must not pick a different mode.
+		 */
+		if (fmt->which == V4L2_SUBDEV_FORMAT_ACTIVE &&
+		    fmt->format.width == imx294->win.width &&
+		    fmt->format.height == imx294->win.height)
+			mode = imx294->mode;
+		else
+			mode = v4l2_find_nearest_size(mode_list,
+						      num_modes,
+						      width, height,
+						      fmt->format.width,
+						      fmt->format.height);
 		imx294_update_image_pad_format(imx294, mode, fmt);
 		if (fmt->which == V4L2_SUBDEV_FORMAT_TRY) {
 			framefmt = v4l2_subdev_get_try_format(sd, sd_state,
 							      fmt->pad);
 			*framefmt = fmt->format;
-		} else if (imx294->mode != mode) {
+		} else if (imx294->mode == mode) {
+			/* Keep any readout window set on the mode */
+			imx294->fmt_code = fmt->format.code;
+			fmt->format.width = imx294->win.width;
+			fmt->format.height = imx294->win.height;
+		} else {
+			const struct imx294_mode *old_mode = imx294->mode;
+			struct v4l2_rect old_win = imx294->win;
+			struct v4l2_rect old_crop = imx294->crop;
+			u32 old_code = imx294->fmt_code;
+
 			imx294->mode = mode;
 			imx294->fmt_code = fmt->format.code;
-			imx294_set_framing_limits(imx294);
+			imx294_reset_window(imx294);
+			if (imx294->streaming) {
+				ret = imx294_switch_mode(imx294);
+				if (ret) {
+					dev_err(&client->dev,
+						"%s failed to switch mode: %d\n",
+						__func__, ret);
+					/*
+					 * Keep the previous format and stop
+					 * the stream, the sensor is in
+					 * standby half way through the switch
+					 */
+					imx294->mode = old_mode;
+					imx294->fmt_code = old_code;
+					imx294->win = old_win;
+					imx294->crop = old_crop;
+					imx294_abort_streaming(imx294);
+					imx294_set_framing_limits(imx294);
+				}
+			} else {
+				imx294_set_framing_limits(imx294);
+			}
 		}
 	} else {
 		if (fmt->which == V4L2_SUBDEV_FORMAT_TRY) {
@@ -1269,8 +2142,116 @@ static int imx294_set_pad_format(struct v4l2_subdev *sd,
 
 	mutex_unlock(&imx294->mutex);
 
+	return ret;
+}
+
+static int imx294_g_frame_interval(struct v4l2_subdev *sd,
+				   struct v4l2_subdev_frame_interval *fi)
+{
+	struct imx294 *imx294 = to_imx294(sd);
+
+	mutex_lock(&imx294->mutex);
+	imx294_timing_to_interval(imx294->HMAX, imx294->VMAX, &fi->interval);
+	mutex_unlock(&imx294->mutex);
+
+	return 0;
+}
+
+/*
+ * Set the frame period through the HBLANK/VBLANK controls, so they stay the
+ * one source of the frame timing, and report the period actually achieved.
+ */
+static int imx294_s_frame_interval(struct v4l2_subdev *sd,
+				   struct v4l2_subdev_frame_interval *fi)
+{
+	struct imx294 *imx294 = to_imx294(sd);
+	struct i2c_client *client = v4l2_get_subdevdata(sd);
+	const struct imx294_mode *mode;
+	u32 hmax, vmax;
+	int ret;
+
+	if (fi->pad != IMAGE_PAD)
+		return -EINVAL;
+
+	mutex_lock(&imx294->mutex);
+
+	mode = imx294->mode;
+	imx294_solve_interval(imx294, &fi->interval, &hmax, &vmax);
+
+	/* Both controls go out in one batch */
+	imx294->ctrl_depth++;
+	imx294_ctrl_batch_begin(imx294);
+	ret = __v4l2_ctrl_s_ctrl(imx294->hblank,
+				 imx294_hmax_to_hblank(imx294, hmax));
+	if (!ret)
+		ret = __v4l2_ctrl_s_ctrl(imx294->vblank,
+					 vmax * mode->VMAX_scale -
+					 imx294->win.height);
+	imx294->ctrl_depth--;
+
+	if (!ret && pm_runtime_get_if_in_use(&client->dev) > 0) {
+		ret = imx294_ctrl_batch_commit(imx294);
+		pm_runtime_put(&client->dev);
+	}
+
+	imx294_timing_to_interval(imx294->HMAX, imx294->VMAX, &fi->interval);
+
+	mutex_unlock(&imx294->mutex);
+
+	return ret;
+}
+
+/* Only the shortest interval is listed, any longer one can be set */
+static int imx294_enum_frame_interval(struct v4l2_subdev *sd,
+				      struct v4l2_subdev_state *sd_state,
+				      struct v4l2_subdev_frame_interval_enum *fie)
+{
+	struct imx294 *imx294 = to_imx294(sd);
+	const struct imx294_mode *mode_list;
+	unsigned int num_modes, i;
+	u32 hmin, vmin;
+
+	if (fie->pad != IMAGE_PAD || fie->index)
+		return -EINVAL;
+
+	get_mode_table(fie->code, &mode_list, &num_modes);
+	if (!num_modes)
+		return -EINVAL;
+
+	mutex_lock(&imx294->mutex);
+
+	/* Only the Bayer order of the current flips is available */
+	if (fie->code != imx294_get_format_code(imx294, fie->code)) {
+		mutex_unlock(&imx294->mutex);
+		return -EINVAL;
+	}
+
+	/* The readout window only applies to the active configuration */
+	if (fie->which == V4L2_SUBDEV_FORMAT_ACTIVE &&
+	    fie->width == imx294->win.width &&
+	    fie->height == imx294->win.height) {
+		hmin = imx294_hblank_to_hmax(imx294, imx294->hblank->minimum);
+		vmin = imx294_min_vmax(imx294);
+	} else {
+		for (i = 0; i < num_modes; i++)
+			if (mode_list[i].width == fie->width &&
+			    mode_list[i].height == fie->height)
+				break;
+		if (i == num_modes) {
+			mutex_unlock(&imx294->mutex);
+			return -EINVAL;
+		}
+		hmin = mode_list[i].min_HMAX;
+		vmin = mode_list[i].min_VMAX;
+	}
+
+	mutex_unlock(&imx294->mutex);
+
+	imx294_timing_to_interval(hmin, vmin, &fie->interval);
+
 	return 0;
 }
+
 /* TODO */
 static const struct v4l2_rect *
 __imx294_get_pad_crop(struct imx294 *imx294,
@@ -1281,54 +2262,114 @@ __imx294_get_pad_crop(struct imx294 *imx294,
 	case V4L2_SUBDEV_FORMAT_TRY:
 		return v4l2_subdev_get_try_crop(&imx294->sd, sd_state, pad);
 	case V4L2_SUBDEV_FORMAT_ACTIVE:
-		return &imx294->mode->crop;
+		return &imx294->crop;
 	}
 
 	return NULL;
 }
 
+/*
+ * Leaving software standby earlier than T7 after XCLR release is not allowed.
+ * Only the part of T7 not already spent on CCI polling and table writes is
+ * waited here.
+ */
+static void imx294_wait_standby_ready(struct imx294 *imx294)
+{
+	s64 elapsed = ktime_us_delta(ktime_get(), imx294->xclr_time);
+	s64 remaining = IMX294_XCLR_STANDBY_DELAY_US +
+			imx294->power_on_margin_us - elapsed;
+
+	if (remaining > 0)
+		fsleep(remaining);
+}
+
 /* Start streaming */
 static int imx294_start_streaming(struct imx294 *imx294)
 {
 	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	const struct IMX294_reg_list *reg_list;
+	bool warm = imx294->common_regs_written;
 	int ret;
 
-	if (!imx294->common_regs_written) {
-		ret = imx294_write_regs(imx294, mode_common_regs,
-					ARRAY_SIZE(mode_common_regs));
+	trace_imx294_phase(&client->dev, warm ? "start_warm" : "start_cold");
+
+	if (!warm) {
+		/* The common table releases standby early on */
+		imx294_wait_standby_ready(imx294);
+		trace_imx294_phase(&client->dev, "standby_ready");
+
+		/*
+		 * The common table carries its own SHR/VMAX/HMAX defaults. This
+		 * is also how a sensor powered down by system suspend gets its
+		 * state back: the tables are replayed in datasheet order and the
+		 * window and control values are layered on top below.
+		 */
+		imx294_shadow_invalidate(imx294);
+		ret = imx294_write_blob(imx294, &imx294_common_blob, false);
 		if (ret) {
 			dev_err(&client->dev, "%s failed to set common settings\n",
 				__func__);
 			return ret;
 		}
-		imx294->common_regs_written = true;
 	}
 
-	/* Apply default values of current mode */
-	reg_list = &imx294->mode->reg_list;
-	ret = imx294_write_regs(imx294, reg_list->regs, reg_list->num_of_regs);
+	/*
+	 * Apply default values of current mode. The mode tables share their
+	 * register layout, so only the registers that differ from what is
+	 * programmed already need to go out.
+	 */
+	if (imx294->programmed_mode != imx294->mode) {
+		ret = imx294_write_blob(imx294,
+					&imx294->mode->blob,
+					true);
+		if (ret) {
+			dev_err(&client->dev, "%s failed to set mode\n", __func__);
+			imx294->programmed_mode = NULL;
+			return ret;
+		}
+		imx294->programmed_mode = imx294->mode;
+	}
+
+	ret = imx294_write_window(imx294);
 	if (ret) {
-		dev_err(&client->dev, "%s failed to set mode\n", __func__);
+		dev_err(&client->dev, "%s failed to set readout window\n",
+			__func__);
 		return ret;
 	}
 
-	/* Apply customized values from user */
-	ret =  __v4l2_ctrl_handler_setup(imx294->sd.ctrl_handler);
+	/*
+	 * Apply customized values from user. HMAX/VMAX already track the
+	 * blanking controls, so the whole timing set goes out as one batch
+	 * rather than through s_ctrl once per control.
+	 */
+	imx294->ctrl_dirty = false;
+	imx294_ctrl_batch_begin(imx294);
+	imx294_queue_timing(imx294);
+	ret = imx294_ctrl_batch_commit(imx294);
+	if (ret)
+		return ret;
+	trace_imx294_phase(&client->dev, "controls_applied");
 
-	return ret;
-}
+	/*
+	 * A sensor kept powered since the last stop only needs MODE_SELECT
+	 * cleared, the rest of the release sequence is still in effect.
+	 */
+	if (warm) {
+		ret = imx294_write_reg_1byte(imx294, IMX294_REG_MODE_SELECT,
+					     IMX294_MODE_STREAMING);
+		if (!ret)
+			trace_imx294_phase(&client->dev, "streaming");
+		return ret;
+	}
 
-/* Stop streaming */
-static void imx294_stop_streaming(struct imx294 *imx294)
-{
-	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	int ret;
+	ret = imx294_write_blob(imx294, &imx294_release_blob, false);
+	if (ret) {
+		dev_err(&client->dev, "%s failed to leave standby\n", __func__);
+		return ret;
+	}
+	imx294->common_regs_written = true;
+	trace_imx294_phase(&client->dev, "streaming");
 
-	/* set stream off register */
-	ret = imx294_write_reg_1byte(imx294, IMX294_REG_MODE_SELECT, IMX294_MODE_STANDBY);
-	if (ret)
-		dev_err(&client->dev, "%s failed to set stream\n", __func__);
+	return 0;
 }
 
 static int imx294_set_stream(struct v4l2_subdev *sd, int enable)
@@ -1344,6 +2385,7 @@ static int imx294_set_stream(struct v4l2_subdev *sd, int enable)
 	}
 
 	if (enable) {
+		trace_imx294_phase(&client->dev, "stream_on");
 		ret = pm_runtime_get_sync(&client->dev);
 		if (ret < 0) {
 			pm_runtime_put_noidle(&client->dev);
@@ -1359,7 +2401,9 @@ static int imx294_set_stream(struct v4l2_subdev *sd, int enable)
 			goto err_rpm_put;
 	} else {
 		imx294_stop_streaming(imx294);
-		pm_runtime_put(&client->dev);
+		/* Stay powered for a while in case streaming restarts */
+		pm_runtime_mark_last_busy(&client->dev);
+		pm_runtime_put_autosuspend(&client->dev);
 	}
 
 	imx294->streaming = enable;
@@ -1368,20 +2412,42 @@ static int imx294_set_stream(struct v4l2_subdev *sd, int enable)
 	return ret;
 
 err_rpm_put:
-	pm_runtime_put(&client->dev);
+	pm_runtime_mark_last_busy(&client->dev);
+	pm_runtime_put_autosuspend(&client->dev);
 err_unlock:
 	mutex_unlock(&imx294->mutex);
 
 	return ret;
 }
 
+/* Verify chip ID */
+static int imx294_identify_module(struct imx294 *imx294, u32 expected_id)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	int ret;
+	u32 val;
+
+	ret = imx294_read_reg(imx294, IMX294_REG_CHIP_ID,
+			      1, &val);
+	if (ret) {
+		dev_err(&client->dev, "failed to read chip id %x, with error %d\n",
+			expected_id, ret);
+		return ret;
+	}
+
+	dev_info(&client->dev, "Device found\n");
+
+	return 0;
+}
+
 /* Power/clock management functions */
 static int imx294_power_on(struct device *dev)
 {
 	struct i2c_client *client = to_i2c_client(dev);
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
 	struct imx294 *imx294 = to_imx294(sd);
-	int ret;
+	unsigned int val;
+	int ret, err;
 
 	ret = regulator_bulk_enable(imx294_NUM_SUPPLIES,
 				    imx294->supplies);
@@ -1390,6 +2456,7 @@ static int imx294_power_on(struct device *dev)
 			__func__);
 		return ret;
 	}
+	trace_imx294_phase(dev, "regulators_on");
 
 	ret = clk_prepare_enable(imx294->xclk);
 	if (ret) {
@@ -1398,12 +2465,40 @@ static int imx294_power_on(struct device *dev)
 		goto reg_off;
 	}
 
+	trace_imx294_phase(dev, "xclk_on");
+
 	gpiod_set_value_cansleep(imx294->reset_gpio, 1);
-	usleep_range(imx294_XCLR_MIN_DELAY_US,
-		     imx294_XCLR_MIN_DELAY_US + imx294_XCLR_DELAY_RANGE_US);
+	imx294->xclr_time = ktime_get();
+	trace_imx294_phase(dev, "xclr_released");
+
+	fsleep(IMX294_XCLR_CCI_DELAY_US + imx294->power_on_margin_us);
+
+	/* The CCI is up once any register read is acknowledged */
+	ret = read_poll_timeout(regmap_read, err, !err, IMX294_CCI_POLL_US,
+				IMX294_CCI_TIMEOUT_US, false, imx294->regmap,
+				IMX294_REG_MODE_SELECT, &val);
+	if (ret) {
+		dev_err(&client->dev, "%s: sensor not responding on CCI (%d)\n",
+			__func__, err);
+		goto xclr_off;
+	}
+
+	trace_imx294_phase(dev, "cci_ready");
+
+	if (!imx294->identified) {
+		ret = imx294_identify_module(imx294,
+					     imx294->compatible_data->chip_id);
+		if (ret)
+			goto xclr_off;
+		imx294->identified = true;
+		trace_imx294_phase(dev, "identified");
+	}
 
 	return 0;
 
+xclr_off:
+	gpiod_set_value_cansleep(imx294->reset_gpio, 0);
+	clk_disable_unprepare(imx294->xclk);
 reg_off:
 	regulator_bulk_disable(imx294_NUM_SUPPLIES, imx294->supplies);
 	return ret;
@@ -1421,18 +2516,54 @@ static int imx294_power_off(struct device *dev)
 
 	/* Force reprogramming of the common registers when powered up again. */
 	imx294->common_regs_written = false;
+	imx294_drop_programmed_state(imx294);
 
 	return 0;
 }
 
+/*
+ * Check that a powered sensor kept its registers over system sleep, the board
+ * may have cut its supplies regardless. VMAX and HMAX differ from their reset
+ * values once programmed, so they are read back and compared against the
+ * register cache.
+ */
+static bool imx294_state_retained(struct imx294 *imx294)
+{
+	u8 cur[5], cached[5];
+	int ret;
+
+	if (!imx294->common_regs_written)
+		return true;
+
+	regcache_cache_bypass(imx294->regmap, true);
+	ret = regmap_bulk_read(imx294->regmap, IMX294_REG_VMAX, cur,
+			       sizeof(cur));
+	regcache_cache_bypass(imx294->regmap, false);
+	if (ret)
+		return false;
+
+	regcache_cache_only(imx294->regmap, true);
+	ret = regmap_bulk_read(imx294->regmap, IMX294_REG_VMAX, cached,
+			       sizeof(cached));
+	regcache_cache_only(imx294->regmap, false);
+
+	return !ret && !memcmp(cur, cached, sizeof(cur));
+}
+
 static int __maybe_unused imx294_suspend(struct device *dev)
 {
 	struct i2c_client *client = to_i2c_client(dev);
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
 	struct imx294 *imx294 = to_imx294(sd);
 
+	/*
+	 * The sensor stays powered in standby, so resume can take the warm
+	 * start path instead of the full power-up sequence.
+	 */
+	mutex_lock(&imx294->mutex);
 	if (imx294->streaming)
 		imx294_stop_streaming(imx294);
+	mutex_unlock(&imx294->mutex);
 
 	return 0;
 }
@@ -1444,17 +2575,27 @@ static int __maybe_unused imx294_resume(struct device *dev)
 	struct imx294 *imx294 = to_imx294(sd);
 	int ret;
 
+	mutex_lock(&imx294->mutex);
+	if (!imx294_state_retained(imx294)) {
+		dev_dbg(dev, "sensor lost its registers over system sleep\n");
+		imx294_power_off(dev);
+		ret = imx294_power_on(dev);
+		if (ret)
+			goto error;
+	}
 	if (imx294->streaming) {
 		ret = imx294_start_streaming(imx294);
 		if (ret)
 			goto error;
 	}
+	mutex_unlock(&imx294->mutex);
 
 	return 0;
 
 error:
 	imx294_stop_streaming(imx294);
 	imx294->streaming = 0;
+	mutex_unlock(&imx294->mutex);
 	return ret;
 }
 
@@ -1471,26 +2612,6 @@ static int imx294_get_regulators(struct imx294 *imx294)
 				       imx294->supplies);
 }
 
-/* Verify chip ID */
-static int imx294_identify_module(struct imx294 *imx294, u32 expected_id)
-{
-	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
-	int ret;
-	u32 val;
-
-	ret = imx294_read_reg(imx294, IMX294_REG_CHIP_ID,
-			      1, &val);
-	if (ret) {
-		dev_err(&client->dev, "failed to read chip id %x, with error %d\n",
-			expected_id, ret);
-		return ret;
-	}
-
-	dev_info(&client->dev, "Device found\n");
-
-	return 0;
-}
-
 static int imx294_get_selection(struct v4l2_subdev *sd,
 				struct v4l2_subdev_state *sd_state,
 				struct v4l2_subdev_selection *sel)
@@ -1528,6 +2649,46 @@ static int imx294_get_selection(struct v4l2_subdev *sd,
 	return -EINVAL;
 }
 
+/*
+ * Only the crop rectangle of the image pad is settable. It selects a readout
+ * window of the current mode, which sets the output size and lets VBLANK go
+ * down to the shorter frame.
+ */
+static int imx294_set_selection(struct v4l2_subdev *sd,
+				struct v4l2_subdev_state *sd_state,
+				struct v4l2_subdev_selection *sel)
+{
+	struct imx294 *imx294 = to_imx294(sd);
+	struct v4l2_mbus_framefmt *try_fmt;
+	struct v4l2_rect win;
+	int ret = 0;
+
+	if (sel->target != V4L2_SEL_TGT_CROP || sel->pad != IMAGE_PAD)
+		return -EINVAL;
+
+	mutex_lock(&imx294->mutex);
+
+	imx294_crop_to_window(imx294->mode, &sel->r, &win);
+	imx294_window_to_crop(imx294->mode, &win, &sel->r);
+
+	if (sel->which == V4L2_SUBDEV_FORMAT_TRY) {
+		*v4l2_subdev_get_try_crop(sd, sd_state, sel->pad) = sel->r;
+		try_fmt = v4l2_subdev_get_try_format(sd, sd_state, sel->pad);
+		try_fmt->width = win.width;
+		try_fmt->height = win.height;
+	} else if (imx294->streaming) {
+		ret = -EBUSY;
+	} else {
+		imx294->win = win;
+		imx294->crop = sel->r;
+		imx294_set_framing_limits(imx294);
+	}
+
+	mutex_unlock(&imx294->mutex);
+
+	return ret;
+}
+
 
 static const struct v4l2_subdev_core_ops imx294_core_ops = {
 	.subscribe_event = v4l2_ctrl_subdev_subscribe_event,
@@ -1536,6 +2697,8 @@ static const struct v4l2_subdev_core_ops imx294_core_ops = {
 
 static const struct v4l2_subdev_video_ops imx294_video_ops = {
 	.s_stream = imx294_set_stream,
+	.g_frame_interval = imx294_g_frame_interval,
+	.s_frame_interval = imx294_s_frame_interval,
 };
 
 static const struct v4l2_subdev_pad_ops imx294_pad_ops = {
@@ -1543,7 +2706,9 @@ static const struct v4l2_subdev_pad_ops imx294_pad_ops = {
 	.get_fmt = imx294_get_pad_format,
 	.set_fmt = imx294_set_pad_format,
 	.get_selection = imx294_get_selection,
+	.set_selection = imx294_set_selection,
 	.enum_frame_size = imx294_enum_frame_size,
+	.enum_frame_interval = imx294_enum_frame_interval,
 };
 
 static const struct v4l2_subdev_ops imx294_subdev_ops = {
@@ -1599,9 +2764,18 @@ static int imx294_init_controls(struct imx294 *imx294)
 					     IMX294_EXPOSURE_STEP,
 					     IMX294_EXPOSURE_DEFAULT);
 
-	v4l2_ctrl_new_std(ctrl_hdlr, &imx294_ctrl_ops, V4L2_CID_ANALOGUE_GAIN,
-			  IMX294_ANA_GAIN_MIN, IMX294_ANA_GAIN_MAX,
-			  IMX294_ANA_GAIN_STEP, IMX294_ANA_GAIN_DEFAULT);
+	imx294->gain = v4l2_ctrl_new_std(ctrl_hdlr, &imx294_ctrl_ops,
+					 V4L2_CID_ANALOGUE_GAIN,
+					 IMX294_ANA_GAIN_MIN, IMX294_ANA_GAIN_MAX,
+					 IMX294_ANA_GAIN_STEP,
+					 IMX294_ANA_GAIN_DEFAULT);
+
+	imx294->framing_policy = v4l2_ctrl_new_custom(ctrl_hdlr,
+						      &imx294_framing_policy_ctrl,
+						      NULL);
+	imx294->readout_time = v4l2_ctrl_new_custom(ctrl_hdlr,
+						    &imx294_readout_time_ctrl,
+						    NULL);
 
 	if (ctrl_hdlr->error) {
 		ret = ctrl_hdlr->error;
@@ -1610,6 +2784,9 @@ static int imx294_init_controls(struct imx294 *imx294)
 		goto error;
 	}
 
+	/* Exposure and gain changes must land on the same frame */
+	v4l2_ctrl_cluster(2, &imx294->exposure);
+
 	ret = v4l2_fwnode_device_parse(&client->dev, &props);
 	if (ret)
 		goto error;
@@ -1640,6 +2817,44 @@ static void imx294_free_controls(struct imx294 *imx294)
 }
 
 
+static int imx294_stats_show(struct seq_file *m, void *unused)
+{
+	struct imx294 *imx294 = m->private;
+	const struct imx294_xfer_stats *stats;
+	unsigned int i, j;
+
+	seq_puts(m, "type\ttransactions\tbytes\tnaks\terrors\tretries\tlatency_us(<1,<2,<4,...)\n");
+	for (i = 0; i < IMX294_NUM_XFER_TYPES; i++) {
+		stats = &imx294->stats[i];
+		seq_printf(m, "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t",
+			   imx294_xfer_names[i], stats->transactions,
+			   stats->bytes, stats->naks, stats->errors,
+			   stats->retries);
+		for (j = 0; j < IMX294_LAT_BUCKETS; j++)
+			seq_printf(m, "%s%u", j ? "," : "", stats->latency[j]);
+		seq_putc(m, '\n');
+	}
+	seq_printf(m, "settle waits %llu, %llu us\n", imx294->settle_waits,
+		   imx294->settle_us);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(imx294_stats);
+
+static void imx294_debugfs_init(struct imx294 *imx294)
+{
+	struct i2c_client *client = v4l2_get_subdevdata(&imx294->sd);
+	char name[32];
+
+	snprintf(name, sizeof(name), "imx294-%s", dev_name(&client->dev));
+	imx294->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, imx294->debugfs, imx294,
+			    &imx294_stats_fops);
+	debugfs_create_bool("verify", 0644, imx294->debugfs, &imx294->verify);
+	debugfs_create_u32("verify_errors", 0444, imx294->debugfs,
+			   &imx294->verify_errors);
+}
+
 static const struct imx294_compatible_data imx294_compatible = {
 	.chip_id = IMX294_CHIP_ID,
 	.extra_regs = {
@@ -1666,6 +2881,12 @@ static int imx294_probe(struct i2c_client *client)
 
 	v4l2_i2c_subdev_init(&imx294->sd, client, &imx294_subdev_ops);
 
+	imx294->regmap = devm_regmap_init_i2c(client, &imx294_regmap_config);
+	if (IS_ERR(imx294->regmap)) {
+		dev_err(dev, "failed to initialise regmap\n");
+		return PTR_ERR(imx294->regmap);
+	}
+
 	match = of_match_device(imx294_dt_ids, dev);
 	if (!match)
 		return -ENODEV;
@@ -1692,27 +2913,34 @@ static int imx294_probe(struct i2c_client *client)
 		return ret;
 	}
 
+	/* Optional board-specific power-up settle time */
+	device_property_read_u32(dev, "sony,power-on-margin-us",
+				 &imx294->power_on_margin_us);
+
 	/* Request optional enable pin */
 	imx294->reset_gpio = devm_gpiod_get_optional(dev, "reset",
 						     GPIOD_OUT_HIGH);
 	
 	/*
-	 * The sensor must be powered for imx294_identify_module()
-	 * to be able to read the CHIP_ID register
+	 * Powering up identifies the sensor. With deferred_identify that is
+	 * left to the first open or stream-on, keeping probe off the bus.
 	 */
-	ret = imx294_power_on(dev);
-	if (ret)
-		return ret;
-
-	ret = imx294_identify_module(imx294, imx294->compatible_data->chip_id);
-	if (ret)
-		goto error_power_off;
+	if (!deferred_identify) {
+		ret = imx294_power_on(dev);
+		if (ret)
+			return ret;
+	}
 
 	/* Initialize default format */
+	imx294_parse_defaults(imx294);
 	imx294_set_default_format(imx294);
+	imx294_shadow_invalidate(imx294);
 
 	/* Enable runtime PM and turn off the device */
-	pm_runtime_set_active(dev);
+	if (!deferred_identify)
+		pm_runtime_set_active(dev);
+	pm_runtime_set_autosuspend_delay(dev, autosuspend_delay_ms);
+	pm_runtime_use_autosuspend(dev);
 	pm_runtime_enable(dev);
 	pm_runtime_idle(dev);
 
@@ -1737,14 +2965,34 @@ static int imx294_probe(struct i2c_client *client)
 		goto error_handler_free;
 	}
 
+	if (async_ctrls) {
+		imx294->ctrl_worker = kthread_create_worker(0, "imx294-%s",
+							    dev_name(dev));
+		if (IS_ERR(imx294->ctrl_worker)) {
+			ret = PTR_ERR(imx294->ctrl_worker);
+			imx294->ctrl_worker = NULL;
+			dev_err(dev, "failed to create control worker: %d\n", ret);
+			goto error_media_entity;
+		}
+		/* Control updates are latency critical under AE/AGC */
+		sched_set_fifo(imx294->ctrl_worker->task);
+		kthread_init_work(&imx294->ctrl_work, imx294_ctrl_work);
+	}
+
 	ret = v4l2_async_register_subdev_sensor(&imx294->sd);
 	if (ret < 0) {
 		dev_err(dev, "failed to register sensor sub-device: %d\n", ret);
-		goto error_media_entity;
+		goto error_ctrl_worker;
 	}
 
+	imx294_debugfs_init(imx294);
+
 	return 0;
 
+error_ctrl_worker:
+	if (imx294->ctrl_worker)
+		kthread_destroy_worker(imx294->ctrl_worker);
+
 error_media_entity:
 	media_entity_cleanup(&imx294->sd.entity);
 
@@ -1752,9 +3000,11 @@ error_handler_free:
 	imx294_free_controls(imx294);
 
 error_power_off:
+	pm_runtime_dont_use_autosuspend(&client->dev);
 	pm_runtime_disable(&client->dev);
+	if (!pm_runtime_status_suspended(&client->dev))
+		imx294_power_off(&client->dev);
 	pm_runtime_set_suspended(&client->dev);
-	imx294_power_off(&client->dev);
 
 	return ret;
 }
@@ -1764,10 +3014,14 @@ static void imx294_remove(struct i2c_client *client)
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
 	struct imx294 *imx294 = to_imx294(sd);
 
+	debugfs_remove_recursive(imx294->debugfs);
 	v4l2_async_unregister_subdev(sd);
+	if (imx294->ctrl_worker)
+		kthread_destroy_worker(imx294->ctrl_worker);
 	media_entity_cleanup(&sd->entity);
 	imx294_free_controls(imx294);
 
+	pm_runtime_dont_use_autosuspend(&client->dev);
 	pm_runtime_disable(&client->dev);
 	if (!pm_runtime_status_suspended(&client->dev))
 		imx294_power_off(&client->dev);
@@ -1787,6 +3041,7 @@ static struct i2c_driver imx294_i2c_driver = {
 		.name = "imx294",
 		.of_match_table	= imx294_dt_ids,
 		.pm = &imx294_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe_new = imx294_probe,
 	.remove = imx294_remove,
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints for the Sony IMX294 sensor driver, covering the power-up and
+ * stream-on sequence so start latency can be broken down with ftrace/perf.
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM imx294
+
+#if !defined(_IMX294_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _IMX294_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/* A boundary between two steps of power-up or stream-on */
+TRACE_EVENT(imx294_phase,
+	TP_PROTO(const struct device *dev, const char *phase),
+	TP_ARGS(dev, phase),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__string(phase, phase)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__assign_str(phase, phase);
+	),
+	TP_printk("%s %s", __get_str(dev), __get_str(phase))
+);
+
+/* A register table has been written out */
+TRACE_EVENT(imx294_table,
+	TP_PROTO(const struct device *dev, const char *table,
+		 unsigned int regs, unsigned int bytes, int ret),
+	TP_ARGS(dev, table, regs, bytes, ret),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__string(table, table)
+		__field(unsigned int, regs)
+		__field(unsigned int, bytes)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__assign_str(table, table);
+		__entry->regs = regs;
+		__entry->bytes = bytes;
+		__entry->ret = ret;
+	),
+	TP_printk("%s %s regs=%u bytes=%u ret=%d", __get_str(dev),
+		  __get_str(table), __entry->regs, __entry->bytes, __entry->ret)
+);
+
+/* A sequencing wait from a register table has ended */
+TRACE_EVENT(imx294_settle,
+	TP_PROTO(const struct device *dev, unsigned int ms, s64 covered_us,
+		 s64 slept_us),
+	TP_ARGS(dev, ms, covered_us, slept_us),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(unsigned int, ms)
+		__field(s64, covered_us)
+		__field(s64, slept_us)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->ms = ms;
+		__entry->covered_us = covered_us;
+		__entry->slept_us = slept_us;
+	),
+	TP_printk("%s %u ms: %lld us covered by writes, slept %lld us",
+		  __get_str(dev), __entry->ms, __entry->covered_us,
+		  __entry->slept_us)
+);
+
+#endif /* _IMX294_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE imx294_trace
+#include <trace/define_trace.h>